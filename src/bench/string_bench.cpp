@@ -0,0 +1,229 @@
+#include "../utility/string.h"
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+// benchmarks for the string utilities that split and convert the output of
+// processes, built by the mob_bench target when MOB_BUILD_BENCHMARKS is on
+//
+// only src/utility/string.cpp is linked in, so this only covers code that
+// doesn't need the rest of mob; these still need a platform layer before they
+// can be benchmarked here:
+//
+//   - parse_ini() and conf lookups, which log through contexts and read files
+//     and environment variables with Win32
+//   - task::name_matches_glob() and task::strings_match(), which need the
+//     task manager and the conf
+//
+
+namespace mob {
+
+    // the benchmarks don't use contexts, an assertion is just fatal
+    //
+    void mob_assertion_failed(const char* message, const char* exp, const wchar_t*,
+                              int line, const char* func)
+    {
+        std::cerr << "assertion failed: " << func << ":" << line << " "
+                  << (message ? message : "") << " (" << exp << ")\n";
+
+        std::abort();
+    }
+
+}  // namespace mob
+
+namespace {
+
+    using namespace mob;
+
+    // output of a build, `size` characters of msvc-like warnings with crlf
+    // newlines, some lines having non-ascii characters in paths if `ascii` is
+    // false
+    //
+    std::wstring make_output(std::size_t size, bool ascii)
+    {
+        const std::wstring ascii_line =
+            L"C:\\dev\\modorganizer\\build\\modorganizer_super\\uibase\\src\\"
+            L"filesystemutilities.cpp(123,45): warning C4996: 'getenv': This "
+            L"function may be unsafe. [C:\\dev\\uibase\\vsbuild\\uibase.vcxproj]\r\n";
+
+        const std::wstring other_line =
+            L"C:\\Users\\J\u00f6rg\\\u30e2\u30c3\u30c9\\src\\main.cpp(7): error "
+            L"C2065: '\u00e9t\u00e9': undeclared identifier \U0001f600\r\n";
+
+        std::wstring s;
+
+        for (std::size_t i = 0; s.size() < size; ++i)
+            s += (ascii || i % 4 != 0) ? ascii_line : other_line;
+
+        s.resize(size);
+        return s;
+    }
+
+    std::string make_utf8_output(std::size_t size)
+    {
+        auto s = utf16_to_utf8(make_output(size, false));
+        s.resize(size);
+        return s;
+    }
+
+    // bytes of the given encoding for make_output()
+    //
+    std::string make_bytes(encodings e, std::size_t size)
+    {
+        if (e == encodings::utf16) {
+            const auto ws = make_output(size / sizeof(wchar_t), false);
+            return std::string(reinterpret_cast<const char*>(ws.data()),
+                               ws.size() * sizeof(wchar_t));
+        }
+
+        // acp can't represent everything, keep it ascii
+        if (e == encodings::acp)
+            return utf16_to_utf8(make_output(size, true));
+
+        return make_utf8_output(size);
+    }
+
+    void bench_find_newline_char(benchmark::State& state)
+    {
+        const auto s = make_utf8_output(static_cast<std::size_t>(state.range(0)));
+        const char* const end = s.data() + s.size();
+
+        for (auto _ : state) {
+            std::size_t n = 0;
+
+            for (const char* p = s.data(); p != end; ++n)
+                p = skip_newlines(find_newline(p, end), end);
+
+            benchmark::DoNotOptimize(n);
+        }
+
+        state.SetBytesProcessed(
+            static_cast<std::int64_t>(state.iterations() * s.size()));
+    }
+
+    void bench_find_newline_wchar(benchmark::State& state)
+    {
+        const auto s = make_output(static_cast<std::size_t>(state.range(0)), false);
+        const wchar_t* const end = s.data() + s.size();
+
+        for (auto _ : state) {
+            std::size_t n = 0;
+
+            for (const wchar_t* p = s.data(); p != end; ++n)
+                p = skip_newlines(find_newline(p, end), end);
+
+            benchmark::DoNotOptimize(n);
+        }
+
+        state.SetBytesProcessed(
+            static_cast<std::int64_t>(state.iterations() * s.size() * sizeof(wchar_t)));
+    }
+
+    void bench_for_each_line(benchmark::State& state)
+    {
+        const auto s = make_utf8_output(static_cast<std::size_t>(state.range(0)));
+
+        for (auto _ : state) {
+            std::size_t n = 0;
+
+            for_each_line(s, [&](std::string_view line) {
+                n += line.size();
+            });
+
+            benchmark::DoNotOptimize(n);
+        }
+
+        state.SetBytesProcessed(
+            static_cast<std::int64_t>(state.iterations() * s.size()));
+    }
+
+    // the output is added in chunks, like process does when reading from the
+    // pipes
+    //
+    void bench_next_utf8_lines(benchmark::State& state, encodings e)
+    {
+        const auto bytes = make_bytes(e, static_cast<std::size_t>(state.range(0)));
+        const std::size_t chunk = 4096;
+
+        for (auto _ : state) {
+            encoded_buffer buffer(e);
+            std::size_t n = 0;
+
+            const auto f = [&](std::string_view line) {
+                n += line.size();
+            };
+
+            for (std::size_t i = 0; i < bytes.size(); i += chunk) {
+                buffer.add(std::string_view(bytes).substr(i, chunk));
+                buffer.next_utf8_lines(false, f);
+            }
+
+            buffer.next_utf8_lines(true, f);
+            benchmark::DoNotOptimize(n);
+        }
+
+        state.SetBytesProcessed(
+            static_cast<std::int64_t>(state.iterations() * bytes.size()));
+    }
+
+    // converts line by line into the same string, like encoded_buffer does
+    //
+    void bench_utf16_to_utf8_lines(benchmark::State& state, bool ascii)
+    {
+        const auto s = make_output(static_cast<std::size_t>(state.range(0)), ascii);
+
+        std::vector<std::wstring_view> lines;
+        for (std::size_t i = 0; i < s.size();) {
+            const auto nl = s.find(L'\n', i);
+            const auto e  = (nl == std::wstring::npos ? s.size() : nl + 1);
+
+            lines.push_back(std::wstring_view(s).substr(i, e - i));
+            i = e;
+        }
+
+        std::string out;
+
+        for (auto _ : state) {
+            for (auto&& line : lines) {
+                utf16_to_utf8(line, out);
+                benchmark::DoNotOptimize(out.data());
+            }
+        }
+
+        state.SetBytesProcessed(
+            static_cast<std::int64_t>(state.iterations() * s.size() * sizeof(wchar_t)));
+    }
+
+    void bench_split_quoted(benchmark::State& state)
+    {
+        // something like a command line
+        std::string s;
+        while (s.size() < static_cast<std::size_t>(state.range(0)))
+            s += "-DCMAKE_INSTALL_PREFIX=\"C:\\dev\\mod organizer\\install\" -G Ninja ";
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(split_quoted(s, " "));
+
+        state.SetBytesProcessed(
+            static_cast<std::int64_t>(state.iterations() * s.size()));
+    }
+
+}  // namespace
+
+BENCHMARK(bench_find_newline_char)->Arg(64 << 10)->Arg(1 << 20);
+BENCHMARK(bench_find_newline_wchar)->Arg(64 << 10)->Arg(1 << 20);
+BENCHMARK(bench_for_each_line)->Arg(64 << 10)->Arg(1 << 20);
+
+BENCHMARK_CAPTURE(bench_next_utf8_lines, utf8, encodings::utf8)->Arg(1 << 20);
+BENCHMARK_CAPTURE(bench_next_utf8_lines, utf16, encodings::utf16)->Arg(1 << 20);
+BENCHMARK_CAPTURE(bench_next_utf8_lines, acp, encodings::acp)->Arg(1 << 20);
+BENCHMARK_CAPTURE(bench_next_utf8_lines, dont_know, encodings::dont_know)->Arg(1 << 20);
+
+BENCHMARK_CAPTURE(bench_utf16_to_utf8_lines, ascii, true)->Arg(1 << 20);
+BENCHMARK_CAPTURE(bench_utf16_to_utf8_lines, non_ascii, false)->Arg(1 << 20);
+
+BENCHMARK(bench_split_quoted)->Arg(4 << 10);
+
+BENCHMARK_MAIN();
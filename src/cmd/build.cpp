@@ -1,9 +1,11 @@
 #include "pch.h"
 #include "../core/conf.h"
 #include "../core/context.h"
+#include "../core/diagnostics.h"
 #include "../core/ini.h"
 #include "../core/op.h"
 #include "../tasks/task_manager.h"
+#include "../tools/tools.h"
 #include "commands.h"
 
 namespace mob {
@@ -87,6 +89,11 @@ namespace mob {
                (clipp::option("--keep-msbuild") >> keep_msbuild_) %
                    "don't terminate msbuild.exe instances after building",
 
+               (clipp::option("--metrics") & clipp::value("PATH") >> utf8_metrics_) %
+                   "writes counters and histograms for the run to the given json "
+                   "file, such as processes spawned, bytes downloaded and files "
+                   "copied",
+
                (clipp::opt_values(clipp::match::prefix_not("-"), "task", tasks_)) %
                    "tasks to run; specify 'super' to only build modorganizer "
                    "projects";
@@ -155,20 +162,61 @@ namespace mob {
         try {
             create_prefix_ini();
 
+            // deletes trash left over from a previous run in the background
+            op::start_trash_reaper(gcx());
+
+            // the reaper can also be started by tasks deleting directories, make
+            // sure it's joined here when bailing out instead of during static
+            // destruction
+            guard reaper([] {
+                op::stop_trash_reaper();
+            });
+
+            // stats printed at the end are only for this build
+            if (!conf().global().dry())
+                cmake::reset_compiler_cache_stats();
+
             task_manager::instance().run_all();
 
+            // whatever is still in the trash is deleted on the next run
+            op::stop_trash_reaper();
+
             if (!keep_msbuild_)
                 terminate_msbuild();
 
+            if (!conf().global().dry()) {
+                cmake::log_compiler_cache_stats();
+                msbuild::log_timings(gcx());
+                write_diagnostics();
+            }
+
+            write_metrics(utf8_metrics_);
+
             mob::gcx().info(mob::context::generic, "mob done");
             return 0;
         }
         catch (bailed&) {
+            // the errors are the interesting part when the build fails
+            if (!conf().global().dry())
+                write_diagnostics();
+
+            write_metrics(utf8_metrics_);
+
             gcx().error(context::generic, "bailing out");
             return 1;
         }
     }
 
+    void build_command::write_diagnostics()
+    {
+        const auto& d = diagnostics::instance();
+
+        d.log_summary(gcx());
+
+        if (const auto f = conf().global().diagnostics_file(); !f.empty())
+            d.write_report(gcx(), f);
+    }
+
     void build_command::create_prefix_ini()
     {
         const auto prefix = conf().path().prefix();
@@ -2,6 +2,7 @@
 #include "commands.h"
 #include "../core/conf.h"
 #include "../core/ini.h"
+#include "../core/metrics.h"
 #include "../net.h"
 #include "../tasks/task_manager.h"
 #include "../tools/tools.h"
@@ -160,6 +161,15 @@ namespace mob {
             throw bailed();
     }
 
+    void command::write_metrics(const std::string& utf8_path)
+    {
+        if (utf8_path.empty())
+            return;
+
+        context::add_log_metrics();
+        metrics::instance().write(gcx(), fs::path(utf8_to_utf16(utf8_path)));
+    }
+
     int command::prepare_options(bool verbose)
     {
         convert_cl_to_conf();
@@ -103,6 +103,11 @@ namespace mob {
         //
         int load_options();
 
+        // writes the metrics gathered so far to the given path, does nothing if
+        // it's empty; used by commands that have --metrics
+        //
+        static void write_metrics(const std::string& utf8_path);
+
         // calls convert_cl_to_conf() and populates inis_
         //
         int prepare_options(bool verbose);
@@ -205,11 +210,17 @@ namespace mob {
         bool ignore_uncommitted_ = false;
         bool keep_msbuild_       = false;
         std::optional<bool> revert_ts_;
+        std::string utf8_metrics_;
 
         // creates a bare bones ini file in the prefix so mob can be invoked in any
         // directory below it
         //
         void create_prefix_ini();
+
+        // logs the diagnostics per task and writes the report, see
+        // global/diagnostics_file
+        //
+        void write_diagnostics();
     };
 
     // applies a pr
@@ -278,9 +289,11 @@ namespace mob {
         release_command();
         meta_t meta() const override;
 
-        void make_bin();
-        void make_pdbs();
-        void make_src();
+        // `threads` is given to the archiver, 0 for its default
+        //
+        void make_bin(std::size_t threads = 0);
+        void make_pdbs(std::size_t threads = 0);
+        void make_src(std::size_t threads = 0);
         void make_installer();
 
     protected:
@@ -307,19 +320,36 @@ namespace mob {
         bool force_ = false;
         std::string suffix_;
         std::string branch_;
+        int jobs_ = 0;
+        std::string profile_;
+        int connections_ = 8;
+        int timeout_     = 30;
+
+        std::string utf8_metrics_;
 
         int do_devbuild();
         int do_official();
 
+        // creates the enabled archives concurrently and copies the installer,
+        // prints progress until everything is done
+        //
+        void make_artifacts();
+
         void prepare();
+        // checks all the enabled super repos for branch_ concurrently and prints
+        // a report; bails out if the branch is missing anywhere or if a repo
+        // couldn't be checked
+        //
         void check_repos_for_branch();
         bool check_clean_prefix();
 
         fs::path make_filename(const std::string& what) const;
 
-        void walk_dir(const fs::path& dir, std::vector<fs::path>& files,
-                      const std::vector<std::regex>& ignore_re,
-                      std::size_t& total_size);
+        // adds every file from the git index of `repo` to `files`, except for
+        // dot files and generated files, and adds their size to `total_size`
+        //
+        void source_files(const fs::path& repo, std::vector<fs::path>& files,
+                          std::size_t& total_size);
 
         std::string version_from_exe() const;
         std::string version_from_rc() const;
@@ -350,19 +380,56 @@ namespace mob {
         bool nopush_       = false;
         bool push_default_ = false;
         bool all_branches_ = false;
+        int jobs_          = 0;
 
-        void do_set_remotes();
-        void do_set_remotes(const fs::path& r);
+        // outcome of running a command on one repo
+        //
+        struct repo_result {
+            fs::path repo;
 
-        void do_add_remote();
-        void do_add_remote(const fs::path& r);
+            // whatever the command printed for this repo, including the logs
+            // of its git processes
+            std::string output;
 
-        void do_ignore_ts();
-        void do_ignore_ts(const fs::path& r);
+            // whether the command bailed out, with the error message, if any
+            bool failed = false;
+            std::string error;
+        };
 
-        void do_branches();
+        // the do_*() functions without a path return the exit code, the others
+        // append their output to `out` instead of printing it and log to `cx`,
+        // which also ends up in `out`
+        //
+        int do_set_remotes();
+        void do_set_remotes(const fs::path& r, const context& cx, std::string& out);
+
+        int do_add_remote();
+        void do_add_remote(const fs::path& r, const context& cx, std::string& out);
+
+        int do_ignore_ts();
+        void do_ignore_ts(const fs::path& r, const context& cx, std::string& out);
+
+        int do_branches();
 
         std::vector<fs::path> get_repos() const;
+
+        // calls f() for every repo from get_repos(), or only for the path given on
+        // the command line, in a thread pool limited by --jobs; returns the
+        // results in the same order as the repos
+        //
+        // each repo gets its own context that captures its logs into the
+        // result's output, so nothing is printed while repos are processed
+        //
+        std::vector<repo_result> for_each_repo(
+            std::function<void(const fs::path&, const context&, std::string&)> f);
+
+        // prints the output of all repos in order, then print_failures()
+        //
+        int print_results(const std::vector<repo_result>& results);
+
+        // prints the repos that failed, returns 1 if there were any, 0 otherwise
+        //
+        int print_failures(const std::vector<repo_result>& results);
     };
 
     // lists the inis found by mob
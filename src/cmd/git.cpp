@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "../tasks/tasks.h"
 #include "../tools/tools.h"
+#include "../utility/threading.h"
 #include "commands.h"
 
 namespace mob {
@@ -19,6 +20,10 @@ namespace mob {
 
             (clipp::option("-h", "--help") >> help_) % ("shows this message"),
 
+            (clipp::option("--jobs") & clipp::value("N") >> jobs_) %
+                "maximum number of repos processed at the same time "
+                "[default: number of cores]",
+
             "set-remotes" %
                     (clipp::command("set-remotes").set(mode_, modes::set_remotes),
                      (clipp::required("-u", "--username") &
@@ -78,23 +83,19 @@ namespace mob {
     {
         switch (mode_) {
         case modes::set_remotes: {
-            do_set_remotes();
-            break;
+            return do_set_remotes();
         }
 
         case modes::add_remote: {
-            do_add_remote();
-            break;
+            return do_add_remote();
         }
 
         case modes::ignore_ts: {
-            do_ignore_ts();
-            break;
+            return do_ignore_ts();
         }
 
         case modes::branches: {
-            do_branches();
-            break;
+            return do_branches();
         }
 
         case modes::none:
@@ -102,8 +103,6 @@ namespace mob {
             u8cerr << "bad git mode " << static_cast<int>(mode_) << "\n";
             throw bailed();
         }
-
-        return 0;
     }
 
     std::string git_command::do_doc()
@@ -127,94 +126,188 @@ namespace mob {
                "\n"
                "branches\n"
                "  Lists all git repos that are not on master. With -a, show all \n"
-               "  repos and their current branch.";
+               "  repos and their current branch. Commits ahead and behind the\n"
+               "  upstream, uncommitted and stashed changes are also shown.\n"
+               "\n"
+               "Repos are processed concurrently, up to --jobs at a time. The\n"
+               "output is shown per repo in the same order every time, followed\n"
+               "by a list of the repos that failed, if any.";
     }
 
-    void git_command::do_set_remotes()
+    int git_command::do_set_remotes()
     {
-        if (path_.empty()) {
-            const auto repos = get_repos();
+        const auto results = for_each_repo([&](auto&& r, auto&& cx, auto&& out) {
+            do_set_remotes(r, cx, out);
+        });
 
-            for (auto&& r : repos)
-                do_set_remotes(r);
-        }
-        else {
-            do_set_remotes(path_);
-        }
+        return print_results(results);
     }
 
-    void git_command::do_set_remotes(const fs::path& r)
+    void git_command::do_set_remotes(const fs::path& r, const context& cx,
+                                     std::string& out)
     {
-        u8cout << "setting up " << path_to_utf8(r.filename()) << "\n";
+        out += "setting up " + path_to_utf8(r.filename()) + "\n";
 
-        git_wrap(r).set_credentials(username_, email_);
+        git_wrap(r, cx).set_credentials(username_, email_);
 
-        git_wrap(r).set_origin_and_upstream_remotes(username_, key_, nopush_,
-                                                    push_default_);
+        git_wrap(r, cx).set_origin_and_upstream_remotes(username_, key_, nopush_,
+                                                        push_default_);
     }
 
-    void git_command::do_add_remote()
+    int git_command::do_add_remote()
     {
-        u8cout << "adding remote '" << remote_ << "' "
-               << "from '" << username_ << "' to repos\n";
+        u8cout << "adding remote '" + remote_ + "' from '" + username_ + "' to repos\n";
 
-        if (path_.empty()) {
-            const auto repos = get_repos();
+        const auto results = for_each_repo([&](auto&& r, auto&& cx, auto&& out) {
+            do_add_remote(r, cx, out);
+        });
 
-            for (auto&& r : repos)
-                do_add_remote(r);
-        }
-        else {
-            do_add_remote(path_);
-        }
+        return print_results(results);
     }
 
-    void git_command::do_add_remote(const fs::path& r)
+    void git_command::do_add_remote(const fs::path& r, const context& cx,
+                                    std::string& out)
     {
-        u8cout << path_to_utf8(r.filename()) << "\n";
-        git_wrap(r).add_remote(remote_, username_, key_, push_default_);
+        out += path_to_utf8(r.filename()) + "\n";
+        git_wrap(r, cx).add_remote(remote_, username_, key_, push_default_);
     }
 
-    void git_command::do_ignore_ts()
+    int git_command::do_ignore_ts()
     {
         if (tson_)
             u8cout << "ignoring .ts files\n";
         else
             u8cout << "un-ignoring .ts files\n";
 
-        if (path_.empty()) {
-            const auto repos = get_repos();
+        const auto results = for_each_repo([&](auto&& r, auto&& cx, auto&& out) {
+            do_ignore_ts(r, cx, out);
+        });
 
-            for (auto&& r : repos)
-                do_ignore_ts(r);
-        }
-        else {
-            do_ignore_ts(path_);
-        }
+        return print_results(results);
     }
 
-    void git_command::do_ignore_ts(const fs::path& r)
+    void git_command::do_ignore_ts(const fs::path& r, const context& cx,
+                                   std::string& out)
     {
-        u8cout << path_to_utf8(r.filename()) << "\n";
-        git_wrap(r).ignore_ts(tson_);
+        out += path_to_utf8(r.filename()) + "\n";
+        git_wrap(r, cx).ignore_ts(tson_);
     }
 
-    void git_command::do_branches()
+    int git_command::do_branches()
     {
+        std::mutex m;
+        std::map<fs::path, git_wrap::repo_status> statuses;
+
+        // one `git status` per repo gives the branch and everything else
+        const auto results = for_each_repo([&](auto&& r, auto&& cx, auto&&) {
+            auto st = git_wrap(r, cx).status();
+
+            if (!st.repo)
+                cx.bail_out(context::generic, "{} is not a git repo", r);
+
+            std::scoped_lock lock(m);
+            statuses[r] = std::move(st);
+        });
+
         std::vector<std::pair<std::string, std::string>> v;
 
-        for (auto&& r : get_repos()) {
-            const auto b = git_wrap(r).current_branch();
-            if (b == "master" && !all_branches_)
+        for (auto&& rr : results) {
+            if (rr.failed)
                 continue;
 
-            if (b.empty())
-                v.push_back({r.filename().string(), "detached head"});
-            else
-                v.push_back({r.filename().string(), b});
+            const auto& st = statuses[rr.repo];
+
+            if (st.branch == "master" && !all_branches_)
+                continue;
+
+            std::string s = (st.branch.empty() ? "detached head" : st.branch);
+
+            if (st.ahead > 0 || st.behind > 0)
+                s += std::format(" [+{} -{} {}]", st.ahead, st.behind, st.upstream);
+
+            if (st.dirty)
+                s += ", uncommitted changes";
+
+            if (st.stashed)
+                s += ", stashed changes";
+
+            v.push_back({rr.repo.filename().string(), s});
         }
 
         u8cout << table(v, 0, 3) << "\n";
+
+        return print_failures(results);
+    }
+
+    std::vector<git_command::repo_result> git_command::for_each_repo(
+        std::function<void(const fs::path&, const context&, std::string&)> f)
+    {
+        const auto repos = (path_.empty() ? get_repos() : std::vector<fs::path>{path_});
+
+        std::vector<repo_result> results(repos.size());
+
+        std::optional<std::size_t> threads;
+        if (jobs_ > 0)
+            threads = static_cast<std::size_t>(jobs_);
+
+        {
+            // joined at the end of the scope
+            thread_pool tp(threads);
+
+            for (std::size_t i = 0; i < repos.size(); ++i) {
+                results[i].repo = repos[i];
+
+                tp.add([&, i] {
+                    auto& rr = results[i];
+
+                    // logs from this repo's processes go in its output instead
+                    // of being interleaved with other repos on the console
+                    context cx(path_to_utf8(rr.repo.filename()));
+                    cx.capture(&rr.output);
+
+                    try {
+                        f(rr.repo, cx, rr.output);
+                    }
+                    catch (bailed& e) {
+                        rr.failed = true;
+                        rr.error  = e.what();
+                    }
+                });
+            }
+        }
+
+        return results;
+    }
+
+    int git_command::print_results(const std::vector<repo_result>& results)
+    {
+        // one call per repo so the lines of a repo stay together
+        for (auto&& rr : results) {
+            if (!rr.output.empty())
+                u8cout << rr.output;
+        }
+
+        return print_failures(results);
+    }
+
+    int git_command::print_failures(const std::vector<repo_result>& results)
+    {
+        std::vector<std::pair<std::string, std::string>> v;
+
+        for (auto&& rr : results) {
+            if (rr.failed) {
+                v.push_back({path_to_utf8(rr.repo.filename()),
+                             (rr.error.empty() ? "failed" : rr.error)});
+            }
+        }
+
+        if (v.empty())
+            return 0;
+
+        u8cerr << "\n" + std::to_string(v.size()) + " repo(s) failed:\n" +
+                      table(v, 2, 3) + "\n";
+
+        return 1;
     }
 
     std::vector<fs::path> git_command::get_repos() const
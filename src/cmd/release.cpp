@@ -20,56 +20,96 @@ namespace mob {
         return {"release", "creates a release"};
     }
 
-    void release_command::make_bin()
+    void release_command::make_bin(std::size_t threads)
     {
         const auto out = out_ / make_filename("");
-        u8cout << "making binary archive " << path_to_utf8(out) << "\n";
+        u8cout.write_ln("making binary archive " + path_to_utf8(out));
 
         op::archive_from_glob(gcx(), conf().path().install_bin() / "*", out,
-                              {"__pycache__"});
+                              {"__pycache__"}, conf().archive(profile_), threads);
     }
 
-    void release_command::make_pdbs()
+    void release_command::make_pdbs(std::size_t threads)
     {
         const auto out = out_ / make_filename("pdbs");
-        u8cout << "making pdbs archive " << path_to_utf8(out) << "\n";
+        u8cout.write_ln("making pdbs archive " + path_to_utf8(out));
 
         op::archive_from_glob(gcx(), conf().path().install_pdbs() / "*", out,
-                              {"__pycache__"});
+                              {"__pycache__"}, conf().archive(profile_), threads);
     }
 
-    void release_command::make_src()
+    void release_command::make_src(std::size_t threads)
     {
         const auto out = out_ / make_filename("src");
-        u8cout << "making src archive " << path_to_utf8(out) << "\n";
-
-        const std::vector<std::string> ignore = {"\\..+",  // dot files
-                                                 "explorer\\+\\+",
-                                                 "stylesheets",
-                                                 "transifex-translations"
-                                                 ".*\\.log",
-                                                 ".*\\.tlog",
-                                                 ".*\\.dll",
-                                                 ".*\\.exe",
-                                                 ".*\\.lib",
-                                                 ".*\\.obj",
-                                                 ".*\\.ts",
-                                                 ".*\\.aps",
-                                                 "(bin|lib)",
-                                                 "vsbuild(32|64)?"};
-
-        const std::vector<std::regex> ignore_re(ignore.begin(), ignore.end());
+        u8cout.write_ln("making src archive " + path_to_utf8(out));
 
-        std::vector<fs::path> files;
-        std::size_t total_size = 0;
+        const auto super = tasks::modorganizer::super_path();
 
-        if (!fs::exists(tasks::modorganizer::super_path())) {
+        if (!fs::exists(super)) {
             gcx().bail_out(context::generic, "modorganizer super path not found: {}",
-                           tasks::modorganizer::super_path());
+                           super);
         }
 
-        // build list list
-        walk_dir(tasks::modorganizer::super_path(), files, ignore_re, total_size);
+        // directories in modorganizer_super that are not part of the sources
+        const std::set<fs::path> ignore_dirs = {"explorer++", "stylesheets",
+                                                "transifex-translations"};
+
+        std::vector<fs::path> repos;
+
+        for (auto&& e : fs::directory_iterator(super)) {
+            if (!e.is_directory() || ignore_dirs.contains(e.path().filename()))
+                continue;
+
+            // .git is a file for submodules
+            if (!fs::exists(e.path() / ".git")) {
+                gcx().trace(context::generic, "{} is not a git repo, skipping",
+                            e.path());
+
+                continue;
+            }
+
+            repos.push_back(e.path());
+        }
+
+        std::sort(repos.begin(), repos.end());
+
+        // the file lists are built from each repo's index concurrently and
+        // merged in order afterwards, so the archive is always the same
+        std::vector<std::vector<fs::path>> lists(repos.size());
+        std::vector<std::size_t> sizes(repos.size(), 0);
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        {
+            // joined at the end of the scope
+            thread_pool tp;
+
+            for (std::size_t i = 0; i < repos.size(); ++i) {
+                tp.add([&, i] {
+                    try {
+                        source_files(repos[i], lists[i], sizes[i]);
+                    }
+                    catch (...) {
+                        // bailed, but also filesystem_error from fs:: calls; this
+                        // must not escape the thread
+                        std::scoped_lock lock(error_mutex);
+                        if (!error)
+                            error = std::current_exception();
+                    }
+                });
+            }
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+
+        std::vector<fs::path> files;
+        std::size_t total_size = 0;
+
+        for (std::size_t i = 0; i < repos.size(); ++i) {
+            files.insert(files.end(), lists[i].begin(), lists[i].end());
+            total_size += sizes[i];
+        }
 
         // should be below 20MB
         const std::size_t max_expected_size = 20 * 1024 * 1024;
@@ -84,7 +124,8 @@ namespace mob {
             }
         }
 
-        op::archive_from_files(gcx(), files, tasks::modorganizer::super_path(), out);
+        op::archive_from_files(gcx(), files, super, out, conf().archive(profile_),
+                               threads);
     }
 
     void release_command::make_installer()
@@ -93,40 +134,177 @@ namespace mob {
         const auto src  = conf().path().install_installer() / file;
         const auto dest = out_;
 
-        u8cout << "copying installer " << file << "\n";
+        u8cout.write_ln("copying installer " + file);
 
         op::copy_file_to_dir_if_better(gcx(), src, dest);
     }
 
-    void release_command::walk_dir(const fs::path& dir, std::vector<fs::path>& files,
-                                   const std::vector<std::regex>& ignore_re,
-                                   std::size_t& total_size)
+    void release_command::make_artifacts()
     {
-        // adds all files that are not in the ignore list to `files`, recursive
+        // every artifact gets its own thread; the archives split the thread
+        // budget between them so the 7z processes don't fight over cores, the
+        // installer is only a copy and doesn't count
+        struct artifact {
+            std::string name;
+            fs::path out;
+            std::function<void(std::size_t)> make;
+        };
+
+        std::vector<artifact> v;
+
+        if (bin_) {
+            v.push_back({"bin", out_ / make_filename(""), [&](std::size_t t) {
+                             make_bin(t);
+                         }});
+        }
+
+        if (pdbs_) {
+            v.push_back({"pdbs", out_ / make_filename("pdbs"), [&](std::size_t t) {
+                             make_pdbs(t);
+                         }});
+        }
+
+        if (src_) {
+            v.push_back({"src", out_ / make_filename("src"), [&](std::size_t t) {
+                             make_src(t);
+                         }});
+        }
+
+        if (installer_) {
+            v.push_back({"installer", {}, [&](std::size_t) {
+                             make_installer();
+                         }});
+        }
+
+        if (v.empty())
+            return;
+
+        const std::size_t budget =
+            (jobs_ > 0 ? static_cast<std::size_t>(jobs_)
+                       : std::max(1u, std::thread::hardware_concurrency()));
 
-        for (auto e : fs::directory_iterator(dir)) {
-            const auto p        = e.path();
-            const auto filename = path_to_utf8(p.filename());
+        const std::size_t archives = (bin_ ? 1 : 0) + (pdbs_ ? 1 : 0) + (src_ ? 1 : 0);
+        std::size_t threads =
+            std::max<std::size_t>(1, budget / std::max<std::size_t>(1, archives));
 
-            bool ignored = false;
+        // an explicit thread count in the profile wins over the budget
+        if (const int pt = conf().archive(profile_).threads(); pt > 0)
+            threads = static_cast<std::size_t>(pt);
+
+        u8cout.write_ln(std::format("creating {} artifacts, {} threads per archive",
+                                    v.size(), threads));
+
+        // how often the size of the archives is printed
+        const auto progress_interval = std::chrono::seconds(10);
+
+        const auto start = std::chrono::steady_clock::now();
+        auto elapsed     = [&] {
+            return std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now() - start);
+        };
+
+        std::mutex m;
+        std::condition_variable cv;
+        std::vector<bool> done(v.size(), false);
+        std::size_t remaining = v.size();
+        std::exception_ptr error;
+
+        {
+            // joined at the end of the scope
+            thread_pool tp(v.size());
+
+            for (std::size_t i = 0; i < v.size(); ++i) {
+                tp.add([&, i] {
+                    bool ok = true;
+
+                    try {
+                        v[i].make(threads);
+                    }
+                    catch (...) {
+                        // bailed, but also filesystem_error or bad_alloc; this
+                        // must not escape the thread
+                        ok = false;
+
+                        std::scoped_lock lock(m);
+                        if (!error)
+                            error = std::current_exception();
+                    }
+
+                    {
+                        std::scoped_lock lock(m);
+                        done[i] = true;
+                        --remaining;
+                    }
+
+                    u8cout.write_ln(std::format("{}: {} after {}", v[i].name,
+                                                (ok ? "done" : "failed"), elapsed()));
+
+                    cv.notify_all();
+                });
+            }
 
-            for (auto&& re : ignore_re) {
-                if (std::regex_match(filename, re)) {
-                    ignored = true;
-                    break;
+            std::unique_lock lock(m);
+
+            while (!cv.wait_for(lock, progress_interval, [&] {
+                return (remaining == 0);
+            })) {
+                for (std::size_t i = 0; i < v.size(); ++i) {
+                    if (done[i] || v[i].out.empty())
+                        continue;
+
+                    std::error_code ec;
+                    const auto size = fs::file_size(v[i].out, ec);
+
+                    u8cout.write_ln(std::format("{}: {} MB written after {}", v[i].name,
+                                                (ec ? 0 : size / (1024 * 1024)),
+                                                elapsed()));
                 }
             }
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
 
-            if (ignored)
+    void release_command::source_files(const fs::path& repo,
+                                       std::vector<fs::path>& files,
+                                       std::size_t& total_size)
+    {
+        // tracked files that are generated or binary, .ts files are regenerated
+        // by lupdate all the time
+        static const std::set<std::wstring> ignore_ext = {
+            L".log", L".tlog", L".dll", L".exe", L".lib", L".obj", L".ts", L".aps"};
+
+        // build output that is sometimes committed by mistake, anywhere in the
+        // path
+        static const std::set<std::wstring> ignore_names = {
+            L"bin", L"lib", L"vsbuild", L"vsbuild32", L"vsbuild64"};
+
+        for (auto&& rel : git_wrap(repo).tracked_files()) {
+            // skip dot files and directories, such as .gitignore or .github, and
+            // build directories
+            const bool ignored = std::any_of(rel.begin(), rel.end(), [](auto&& c) {
+                const auto& s = c.native();
+                return (s.starts_with(L'.') || ignore_names.contains(s));
+            });
+
+            if (ignored || ignore_ext.contains(rel.extension().native()))
                 continue;
 
-            if (e.is_directory()) {
-                walk_dir(e.path(), files, ignore_re, total_size);
-            }
-            else if (e.is_regular_file()) {
-                total_size += fs::file_size(p);
-                files.push_back(p);
+            const auto p = repo / rel;
+
+            // submodules are in the index as directories, and deleted files are
+            // still tracked until committed
+            std::error_code ec;
+            const auto size = fs::file_size(p, ec);
+
+            if (ec) {
+                gcx().trace(context::generic, "skipping {}, not a file", p);
+                continue;
             }
+
+            total_size += size;
+            files.push_back(p);
         }
     }
 
@@ -143,7 +321,7 @@ namespace mob {
         if (!what.empty())
             filename += "-" + what;
 
-        filename += ".7z";
+        filename += conf().archive(profile_).extension();
 
         return filename;
     }
@@ -155,6 +333,17 @@ namespace mob {
 
             (clipp::option("-h", "--help") >> help_) % ("shows this message"),
 
+            (clipp::option("--jobs") & clipp::value("N") >> jobs_) %
+                "maximum number of threads used to create archives, shared by all "
+                "the archives created concurrently [default: number of cores]",
+
+            (clipp::option("--profile") & clipp::value("NAME") >> profile_) %
+                "compression profile from the [archive-NAME] section of the INI "
+                "[default: devbuild or official, depending on the mode]",
+
+            (clipp::option("--metrics") & clipp::value("PATH") >> utf8_metrics_) %
+                "writes counters and histograms for the run to the given json file",
+
             "devbuild" %
                     (clipp::command("devbuild").set(mode_, modes::devbuild),
                      (clipp::option("--bin").set(bin_, true) |
@@ -201,9 +390,21 @@ namespace mob {
 
                 |
 
-                "official" % (clipp::command("official").set(mode_, modes::official),
-                              (clipp::value("branch") >> branch_) %
-                                  "use this branch in the super repos"));
+                "official" %
+                    (clipp::command("official").set(mode_, modes::official),
+
+                     (clipp::option("--connections") &
+                      clipp::value("N") >> connections_) %
+                         "maximum number of repos checked for the branch at the "
+                         "same time [default: 8]",
+
+                     (clipp::option("--timeout") &
+                      clipp::value("SECONDS") >> timeout_) %
+                         "gives up on checking a repo for the branch after this "
+                         "many seconds [default: 30]",
+
+                     (clipp::value("branch") >> branch_) %
+                         "use this branch in the super repos"));
     }
 
     void release_command::convert_cl_to_conf()
@@ -225,6 +426,16 @@ namespace mob {
 
     int release_command::do_run()
     {
+        // also written when bailing out
+        guard g([&] {
+            write_metrics(utf8_metrics_);
+        });
+
+        // a no-op if it was already stopped, but the build can bail out
+        guard reaper([] {
+            op::stop_trash_reaper();
+        });
+
         switch (mode_) {
         case modes::devbuild:
             return do_devbuild();
@@ -241,6 +452,12 @@ namespace mob {
 
     int release_command::do_devbuild()
     {
+        if (profile_.empty())
+            profile_ = "devbuild";
+
+        // bails out if the profile doesn't exist
+        conf().archive(profile_).format();
+
         prepare();
 
         u8cout
@@ -248,23 +465,19 @@ namespace mob {
             << "\n"
             << "creating release for " << version_ << "\n";
 
-        if (bin_)
-            make_bin();
-
-        if (pdbs_)
-            make_pdbs();
-
-        if (src_)
-            make_src();
-
-        if (installer_)
-            make_installer();
+        make_artifacts();
 
         return 0;
     }
 
     int release_command::do_official()
     {
+        if (profile_.empty())
+            profile_ = "official";
+
+        // bails out now if the profile doesn't exist instead of after the build
+        conf().archive(profile_).format();
+
         set_sigint_handler();
 
         // make sure the given branch exists in all repos, this avoids failure
@@ -276,48 +489,120 @@ namespace mob {
             return 1;
 
         task_manager::instance().run_all();
+        op::stop_trash_reaper();
         build_command::terminate_msbuild();
 
         prepare();
-        make_bin();
-        make_pdbs();
-        make_src();
-        make_installer();
+
+        // official releases always have everything
+        bin_       = true;
+        pdbs_      = true;
+        src_       = true;
+        installer_ = true;
+
+        make_artifacts();
 
         return 0;
     }
 
     void release_command::check_repos_for_branch()
     {
-        u8cout << "checking repos for branch " << branch_ << "...\n";
+        using status = git_wrap::branch_status;
+
+        struct result {
+            const tasks::modorganizer* task = nullptr;
+            status s                        = status::failed;
+            std::string error;
+            std::chrono::milliseconds time{0};
+        };
 
-        thread_pool tp;
-        std::atomic<bool> failed = false;
+        std::vector<result> results;
 
+        // the alias also has super_build, which has no repo
         for (const auto* t : task_manager::instance().find("super")) {
-            if (!t->enabled())
-                continue;
+            const auto* mo = dynamic_cast<const tasks::modorganizer*>(t);
 
-            tp.add([this, t, &failed] {
-                const auto* o = dynamic_cast<const tasks::modorganizer*>(t);
+            if (mo && t->enabled())
+                results.push_back({mo});
+        }
 
-                if (!git_wrap::remote_branch_exists(o->git_url(), branch_)) {
-                    gcx().error(context::generic,
-                                "branch {} doesn't exist in the {} repo", branch_,
-                                o->name());
+        std::sort(results.begin(), results.end(), [](auto&& a, auto&& b) {
+            return (a.task->name() < b.task->name());
+        });
 
-                    failed = true;
-                }
-            });
+        const std::size_t connections =
+            std::max<std::size_t>(1, std::min<std::size_t>(
+                                         results.size(), std::max(connections_, 1)));
+
+        const std::chrono::seconds timeout(std::max(timeout_, 1));
+
+        u8cout.write_ln(std::format("checking {} repos for branch {}, {} at a time...",
+                                    results.size(), branch_, connections));
+
+        // each thread writes to its own result, they're reported in order after
+        {
+            thread_pool tp(connections);
+
+            for (auto& r : results) {
+                tp.add([&, this] {
+                    const auto start = hr_clock::now();
+
+                    r.s = git_wrap::check_remote_branch(r.task->git_url(), branch_,
+                                                        timeout, &r.error);
+
+                    r.time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        hr_clock::now() - start);
+                });
+            }
+        }
+
+        std::vector<std::pair<std::string, std::string>> report;
+        std::size_t failed = 0;
+
+        for (auto&& r : results) {
+            std::string what;
+
+            switch (r.s) {
+            case status::found:
+                what = "ok";
+                break;
+
+            case status::missing:
+                what = "branch doesn't exist";
+                break;
+
+            case status::timed_out:
+                what = std::format("timed out after {}s", timeout.count());
+                break;
+
+            case status::failed:
+            default: {
+                // the first line of stderr is usually enough
+                what = "failed";
+
+                if (!r.error.empty())
+                    what += ", " + r.error.substr(0, r.error.find('\n'));
+
+                break;
+            }
+            }
+
+            if (r.s != status::found)
+                ++failed;
+
+            const double secs = r.time.count() / 1000.0;
+            report.push_back({r.task->name(), std::format("{:.1f}s  {}", secs, what)});
         }
 
-        tp.join();
+        u8cout.write_ln(table(report, 2, 2));
 
-        if (failed) {
+        if (failed > 0) {
             gcx().bail_out(context::generic,
-                           "either fix the branch name, create a remote branch for the "
-                           "repos that don't have it, or disable tasks with "
-                           "`-s TASKNAME:task/enabled=false`");
+                           "{} of {} repos failed the check for branch {}; either fix "
+                           "the branch name, create a remote branch for the repos "
+                           "that don't have it, or disable tasks with "
+                           "`-s TASKNAME:task/enabled=false`",
+                           failed, results.size(), branch_);
         }
     }
 
@@ -402,18 +687,25 @@ namespace mob {
                "devbuild\n"
                "  Can creates three archives in `$prefix/releases/version`: one from\n"
                "  `install/bin/*`, one from `install/pdbs/*` and another with the\n"
-               "  sources of projects from modorganizer_super.\n"
+               "  sources of projects from modorganizer_super, taken from the git\n"
+               "  index of each repo.\n"
                "  \n"
-               "  The archive filename is `Mod.Organizer-version-suffix-what.7z`,\n"
+               "  The archive filename is `Mod.Organizer-version-suffix-what.ext`,\n"
                "  where:\n"
                "    - `version` is taken from `ModOrganizer.exe`, `version.rc`\n"
                "      or from --version;\n"
                "    - `suffix` is the optional `--suffix` argument;\n"
-               "    - `what` is either nothing, `src` or `pdbs`.\n"
+               "    - `what` is either nothing, `src` or `pdbs`;\n"
+               "    - `ext` depends on the format of the compression profile.\n"
+               "  \n"
+               "  The archives are created concurrently, sharing the threads given\n"
+               "  with --jobs.\n"
                "\n"
                "official\n"
-               "  Creates a new full build in the prefix. Requires that directory\n"
-               "  to be empty. Puts the binary archive, source, PDBs and installer\n"
+               "  Checks that the branch exists in all the super repos, up to\n"
+               "  --connections at a time, then creates a new full build in the\n"
+               "  prefix. Requires that directory to be empty. Puts the binary\n"
+               "  archive, source, PDBs and installer\n"
                "  in `$prefix/releases/version`. Forces all tasks to be enabled,\n"
                "  including translations and installer. Make sure the transifex API\n"
                "  key is in the INI or TX_TOKEN is set.";
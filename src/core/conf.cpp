@@ -32,6 +32,8 @@ namespace mob::details {
     static int g_file_log_level   = 5;
     static bool g_dry             = false;
 
+    static conf_global::copy_modes g_copy_mode = conf_global::copy_modes::copy;
+
     // check if the two given string are equals case-insensitive
     //
     bool case_insensitive_equals(std::string_view lhs, std::string_view rhs)
@@ -122,6 +124,22 @@ namespace mob::details {
         g_conf[section][key] = value;
     }
 
+    // archive profiles can be added from any ini or the command line, unlike
+    // other sections; a new profile starts as a copy of [archive-devbuild] so
+    // only the options that differ have to be given
+    //
+    void add_archive_profile_if_missing(const std::string& section)
+    {
+        if (!section.starts_with("archive-") || g_conf.contains(section))
+            return;
+
+        auto itor = g_conf.find("archive-devbuild");
+        if (itor == g_conf.end())
+            gcx().bail_out(context::conf, "[archive-devbuild] doesn't exist");
+
+        g_conf.emplace(section, itor->second);
+    }
+
     // finds an option for the given task, returns empty if not found
     //
     std::optional<std::string> find_string_for_task(std::string_view task_name,
@@ -212,12 +230,14 @@ namespace mob::details {
         g_tasks[task_name][key] = std::move(value);
     }
 
-    // read a CMake constant from the configuration
+    // reads a value that must be one of the given names, case-insensitive, such
+    // as a CMake constant or an archive format; bails out with the list of
+    // allowed values if it's not found
     //
     template <typename T>
-    T parse_cmake_value(std::string_view section, std::string_view key,
-                        std::string_view value,
-                        std::unordered_map<T, std::string_view> const& values)
+    T parse_enum_value(std::string_view section, std::string_view key,
+                       std::string_view value,
+                       std::unordered_map<T, std::string_view> const& values)
     {
         for (const auto& [value_c, value_s] : values) {
             if (case_insensitive_equals(value_s, value)) {
@@ -312,6 +332,11 @@ namespace mob {
         return lines;
     }
 
+    static std::unordered_map<conf_global::copy_modes, std::string_view>
+        copy_mode_values{{conf_global::copy_modes::copy, "copy"},
+                         {conf_global::copy_modes::hardlink, "hardlink"},
+                         {conf_global::copy_modes::reflink, "reflink"}};
+
     // sets commonly used options that need to be converted to int/bool, for
     // performance
     //
@@ -320,6 +345,11 @@ namespace mob {
         details::g_output_log_level = details::get_int("global", "output_log_level");
         details::g_file_log_level   = details::get_int("global", "file_log_level");
         details::g_dry              = details::get_bool("global", "dry");
+
+        // checked for every copied file
+        details::g_copy_mode = details::parse_enum_value(
+            "global", "copy_mode", details::get_string("global", "copy_mode"),
+            copy_mode_values);
     }
 
     // sets an option `key` in the `paths` section; if the path is currently empty,
@@ -448,10 +478,13 @@ namespace mob {
         else {
             // not a task option, goes into g_conf
 
-            if (master)
+            if (master) {
                 details::add_string(section, key, value);
-            else
+            }
+            else {
+                details::add_archive_profile_if_missing(section);
                 details::set_string(section, key, value);
+            }
         }
     }
 
@@ -692,6 +725,11 @@ namespace mob {
         return {};
     }
 
+    conf_archive conf::archive(std::string_view profile)
+    {
+        return {profile};
+    }
+
     conf_paths conf::path()
     {
         return {};
@@ -714,6 +752,20 @@ namespace mob {
         return details::g_dry;
     }
 
+    fs::path conf_global::diagnostics_file() const
+    {
+        const fs::path p = get("diagnostics_file");
+        if (p.empty() || p.is_absolute())
+            return p;
+
+        return conf().path().prefix() / p;
+    }
+
+    conf_global::copy_modes conf_global::copy_mode() const
+    {
+        return details::g_copy_mode;
+    }
+
     // use appropriate case for the below constants since we will be using them in
     // to_string, although most of cmake and msbuild is case-insensitive so it will
     // not matter much in the end
@@ -732,7 +784,7 @@ namespace mob {
 
     conf_cmake::constant conf_cmake::install_message() const
     {
-        return details::parse_cmake_value(
+        return details::parse_enum_value(
             name(), "install_message", details::get_string(name(), "install_message"),
             constant_values);
     }
@@ -742,6 +794,16 @@ namespace mob {
         return details::get_string(name(), "host");
     }
 
+    fs::path conf_cmake::compiler_launcher() const
+    {
+        return details::get_string(name(), "compiler_launcher");
+    }
+
+    bool conf_cmake::super_build() const
+    {
+        return details::get_bool(name(), "super_build");
+    }
+
     conf_task::conf_task(std::vector<std::string> names) : names_(std::move(names)) {}
 
     std::string conf_task::get(std::string_view key) const
@@ -756,7 +818,7 @@ namespace mob {
 
     mob::config conf_task::configuration() const
     {
-        return details::parse_cmake_value(
+        return details::parse_enum_value(
             names_[0], "configuration",
             details::get_string_for_task(names_, "configuration"),
             details::s_configuration_values);
@@ -772,6 +834,27 @@ namespace mob {
 
     conf_prebuilt::conf_prebuilt() : conf_section("prebuilt") {}
 
+    static std::unordered_map<conf_archive::formats, std::string_view> format_values{
+        {conf_archive::formats::sevenz, "7z"},
+        {conf_archive::formats::zip, "zip"},
+        {conf_archive::formats::tar_zst, "tar.zst"}};
+
+    conf_archive::conf_archive(std::string_view profile)
+        : conf_section("archive-" + std::string(profile))
+    {
+    }
+
+    conf_archive::formats conf_archive::format() const
+    {
+        return details::parse_enum_value(
+            name(), "format", details::get_string(name(), "format"), format_values);
+    }
+
+    std::string conf_archive::extension() const
+    {
+        return "." + std::string(format_values.at(format()));
+    }
+
     conf_paths::conf_paths() : conf_section("paths") {}
 
 }  // namespace mob
@@ -106,6 +106,10 @@ namespace mob {
     //
     class conf_global : public conf_section<std::string> {
     public:
+        // how op::copy_*() functions create files, see copy_mode()
+        //
+        enum class copy_modes { copy, hardlink, reflink };
+
         conf_global();
 
         // convenience, doesn't need string manipulation
@@ -121,6 +125,32 @@ namespace mob {
         bool clean() const { return get<bool>("clean_task"); }
         bool fetch() const { return get<bool>("fetch_task"); }
         bool build() const { return get<bool>("build_task"); }
+        bool trash_deletes() const { return get<bool>("trash_deletes"); }
+        bool copy_hash() const { return get<bool>("copy_hash"); }
+        bool msbuild_binlog() const { return get<bool>("msbuild_binlog"); }
+
+        // maximum number of parallel jobs given to build tools, 0 to let them
+        // decide
+        //
+        int jobs() const { return get<int>("jobs"); }
+
+        // maximum number of threads used when copying directories, 0 for one per
+        // core
+        //
+        int copy_threads() const { return get<int>("copy_threads"); }
+
+        // whether files are copied normally, hard linked or cloned when
+        // installing into path/install, anything else is always copied; links
+        // and clones fall back to a copy when they fail, such as across volumes
+        //
+        // parsed once when the options are loaded, like the log levels
+        //
+        copy_modes copy_mode() const;
+
+        // where the json report of the warnings and errors from the build tools
+        // is written, relative to the prefix; empty for none
+        //
+        fs::path diagnostics_file() const;
     };
 
     // options in [cmake]
@@ -144,6 +174,16 @@ namespace mob {
         // an empty string means no host configured
         //
         std::string host() const;
+
+        // path to a compiler launcher such as ccache or sccache, passed as
+        // CMAKE_<LANG>_COMPILER_LAUNCHER; empty for none
+        //
+        fs::path compiler_launcher() const;
+
+        // whether modorganizer projects are built together by the super_build
+        // task instead of one by one
+        //
+        bool super_build() const;
     };
 
     // options in [task] or [task_name:task]
@@ -171,6 +211,10 @@ namespace mob {
         bool ignore_ts() const { return get<bool>("ignore_ts"); }
         std::string git_url_prefix() const { return get("git_url_prefix"); }
         bool git_shallow() const { return get<bool>("git_shallow"); }
+        std::string git_filter() const { return get("git_filter"); }
+        std::string git_sparse() const { return get("git_sparse"); }
+        bool git_mirror() const { return get<bool>("git_mirror"); }
+        std::string cmake_generator() const { return get("cmake_generator"); }
         std::string git_user() const { return get("git_username"); }
         std::string git_email() const { return get("git_email"); }
         bool set_origin_remote() const { return get<bool>("set_origin_remote"); }
@@ -230,6 +274,37 @@ namespace mob {
         conf_prebuilt();
     };
 
+    // options in [archive-NAME], a compression profile used when creating
+    // archives, such as [archive-devbuild] or [archive-official]
+    //
+    class conf_archive : public conf_section<std::string> {
+    public:
+        // 7z and zip are created by 7z, tar.zst in-process by libarchive
+        //
+        enum class formats { sevenz, zip, tar_zst };
+
+        conf_archive(std::string_view profile);
+
+        formats format() const;
+
+        // extension for the format, including the dot, such as ".7z"
+        //
+        std::string extension() const;
+
+        // 0-9 for 7z and zip, 1-22 for zstd
+        //
+        int level() const { return get<int>("level"); }
+
+        // maximum number of threads, 0 lets the archiver decide
+        //
+        int threads() const { return get<int>("threads"); }
+
+        // solid block size for 7z, given to -ms, such as "on", "off" or "64m";
+        // empty for 7z's default, ignored for other formats
+        //
+        std::string solid_block() const { return get("solid_block"); }
+    };
+
     // options in [paths]
     //
     class conf_paths : public conf_section<fs::path> {
@@ -286,6 +361,7 @@ namespace mob {
         conf_prebuilt prebuilt();
         conf_versions version();
         conf_build_types build_types();
+        conf_archive archive(std::string_view profile);
         conf_paths path();
 
         // opens the log file, creates the directory if needed
@@ -4,6 +4,7 @@
 #include "../tools/tools.h"
 #include "../utility.h"
 #include "conf.h"
+#include "metrics.h"
 
 namespace mob {
 
@@ -20,6 +21,12 @@ namespace mob {
     // global output mutex to avoid interleaving, but also mixing colors
     static std::mutex g_mutex;
 
+    // number of log lines emitted, indexed by level; these are counted on every
+    // line, so they're only added to the metrics in add_log_metrics()
+    static std::array<std::atomic<std::size_t>,
+                      static_cast<std::size_t>(context::level::error) + 1>
+        g_log_lines = {};
+
     // returns the color associated with the given level
     //
     console_color level_color(context::level lv)
@@ -42,6 +49,28 @@ namespace mob {
         }
     }
 
+    // converts a level to string, used for metrics
+    //
+    const char* level_string(context::level lv)
+    {
+        switch (lv) {
+        case context::level::dump:
+            return "dump";
+        case context::level::trace:
+            return "trace";
+        case context::level::debug:
+            return "debug";
+        case context::level::info:
+            return "info";
+        case context::level::warning:
+            return "warning";
+        case context::level::error:
+            return "error";
+        default:
+            return "?";
+        }
+    }
+
     // converts a reason to string
     //
     const char* reason_string(context::reason r)
@@ -179,10 +208,20 @@ namespace mob {
     }
 
     context::context(std::string task_name)
-        : task_(std::move(task_name)), tool_(nullptr)
+        : task_(std::move(task_name)), tool_(nullptr), capture_(nullptr)
     {
     }
 
+    void context::capture(std::string* out)
+    {
+        capture_ = out;
+    }
+
+    const std::string& context::task_name() const
+    {
+        return task_;
+    }
+
     void context::set_tool(tool* t)
     {
         tool_ = t;
@@ -229,6 +268,18 @@ namespace mob {
         g_log_file.reset();
     }
 
+    void context::add_log_metrics()
+    {
+        for (std::size_t i = 0; i < g_log_lines.size(); ++i) {
+            const auto n = g_log_lines[i].exchange(0, std::memory_order_relaxed);
+
+            if (n > 0) {
+                metrics::instance().add("log.lines",
+                                        level_string(static_cast<level>(i)), n);
+            }
+        }
+    }
+
     void context::log_string(reason r, level lv, std::string_view s) const
     {
         if (!enabled(lv))
@@ -256,13 +307,22 @@ namespace mob {
 
     void context::emit_log(level lv, std::string_view utf8) const
     {
+        g_log_lines[static_cast<std::size_t>(lv)].fetch_add(1,
+                                                           std::memory_order_relaxed);
+
         std::scoped_lock lock(g_mutex);
 
         // console
         if (log_enabled(lv, mob::conf().global().output_log_level())) {
-            // will revert color in dtor
-            console_color c = level_color(lv);
-            u8cout.write_ln(utf8);
+            if (capture_) {
+                capture_->append(utf8);
+                capture_->append("\n");
+            }
+            else {
+                // will revert color in dtor
+                console_color c = level_color(lv);
+                u8cout.write_ln(utf8);
+            }
         }
 
         // log file
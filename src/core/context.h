@@ -99,15 +99,33 @@ namespace mob {
         //
         static void close_log_file();
 
+        // adds the number of log lines emitted so far to the metrics as
+        // "log.lines", by level; called before the metrics are written, the
+        // counts start over so they're not added twice
+        //
+        static void add_log_metrics();
+
         // creates a context for a task; the global context has no name
         //
         context(std::string task_name);
 
+        // name given in the constructor, empty for the global context
+        //
+        const std::string& task_name() const;
+
         // sets the tool that's currently running, may be null if there isn't one;
         // log entries will have the name of the tool if one is set
         //
         void set_tool(tool* t);
 
+        // when not null, log lines that would be shown on the console are appended
+        // to `out` instead, one per line; the log file is not affected
+        //
+        // this is used by `mob git` so the output of each repo can be printed
+        // together once the repo is done
+        //
+        void capture(std::string* out);
+
         // logs a simple string with the given level
         //
         void log_string(reason r, level lv, std::string_view s) const;
@@ -186,6 +204,9 @@ namespace mob {
         // current tool, may be null
         const tool* tool_;
 
+        // see capture(), may be null
+        std::string* capture_;
+
         // all logs above end up in here; if `bail` is true, this will throw a
         // bailed exception after logging
         //
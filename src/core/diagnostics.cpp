@@ -0,0 +1,295 @@
+#include "pch.h"
+#include "diagnostics.h"
+#include "context.h"
+#include "op.h"
+
+namespace mob {
+
+    namespace {
+
+        // `file(line,col): error C2065: message`, also `file(line)` and the
+        // `file(line,col,line,col)` ranges from clang-cl; the code is optional
+        // for clang-cl
+        //
+        const std::regex paren_regex(
+            R"(^\s*(.+?)\((\d+)(?:,(\d+))?(?:,\d+,\d+)?\)\s*:\s*)"
+            R"((?:fatal )?(error|warning)\s*([A-Z]+\d+)?\s*:\s*(.*)$)");
+
+        // `file:line:col: warning: message`, the file may start with a drive
+        //
+        const std::regex gnu_regex(
+            R"(^\s*((?:[A-Za-z]:)?[^:]+):(\d+):(\d+):\s*)"
+            R"((?:fatal )?(error|warning):\s*(.*)$)");
+
+        // `file : error LNK2019: message`, `LINK : fatal error LNK1181: message`
+        // or `cl : command line warning D9025: message`
+        //
+        const std::regex tool_regex(
+            R"(^\s*(.+?)\s*:\s*(?:command line )?(?:fatal )?(error|warning)\s*)"
+            R"(([A-Z]+\d+)\s*:\s*(.*)$)");
+
+        // `CMake Warning (dev) at file:line (command):`
+        //
+        const std::regex cmake_at_regex(
+            R"(^CMake (Error|Warning)(?: \(dev\))? at (.+?):(\d+) \((\w+)\):?\s*$)");
+
+        // `CMake Error: message`
+        //
+        const std::regex cmake_regex(R"(^CMake (Error|Warning)(?: \(dev\))?: (.*)$)");
+
+        // clang puts the flag at the end, like `message [-Wunused-variable]`
+        //
+        const std::regex clang_flag_regex(R"(^(.*?)\s*\[(-W[^\]]+)\]$)");
+
+        // msbuild adds ` [C:\path\project.vcxproj]` at the end of lines
+        //
+        const std::regex msbuild_project_regex(R"(^(.*?)\s*\[[^\]]+proj\]$)");
+
+        int to_int(const std::ssub_match& m)
+        {
+            const auto s = m.str();
+            int i        = 0;
+
+            std::from_chars(s.data(), s.data() + s.size(), i);
+            return i;
+        }
+
+        diagnostic::severities to_severity(const std::string& s)
+        {
+            if (s == "error" || s == "Error")
+                return diagnostic::error;
+            else
+                return diagnostic::warning;
+        }
+
+        // "link" for LNK, "msbuild" for MSB, "msvc" for the rest
+        //
+        std::string tool_for_code(std::string_view code)
+        {
+            if (code.starts_with("LNK"))
+                return "link";
+            else if (code.starts_with("MSB"))
+                return "msbuild";
+            else
+                return "msvc";
+        }
+
+        // moves a trailing [-Wflag] from the message to the code
+        //
+        void extract_clang_flag(diagnostic& d)
+        {
+            std::smatch m;
+            const std::string s = d.message;
+
+            if (std::regex_match(s, m, clang_flag_regex)) {
+                d.message = m[1].str();
+                d.code    = m[2].str();
+            }
+        }
+
+    }  // namespace
+
+    std::optional<diagnostic> diagnostic::parse(std::string_view sv)
+    {
+        // most lines are not diagnostics, don't bother with the regexes
+        if (sv.find("error") == std::string_view::npos &&
+            sv.find("warning") == std::string_view::npos &&
+            !sv.starts_with("CMake ")) {
+            return {};
+        }
+
+        std::string line(sv);
+        std::smatch m;
+
+        if (std::regex_match(line, m, msbuild_project_regex))
+            line = m[1].str();
+
+        diagnostic d;
+
+        if (std::regex_match(line, m, paren_regex)) {
+            d.severity = to_severity(m[4].str());
+            d.code     = m[5].str();
+            d.tool     = d.code.empty() ? "clang" : tool_for_code(d.code);
+            d.file     = m[1].str();
+            d.line     = to_int(m[2]);
+            d.column   = m[3].matched ? to_int(m[3]) : 0;
+            d.message  = m[6].str();
+
+            if (d.code.empty())
+                extract_clang_flag(d);
+        }
+        else if (std::regex_match(line, m, cmake_at_regex)) {
+            d.severity = to_severity(m[1].str());
+            d.tool     = "cmake";
+            d.file     = m[2].str();
+            d.line     = to_int(m[3]);
+            d.message  = m[4].str();
+        }
+        else if (std::regex_match(line, m, cmake_regex)) {
+            d.severity = to_severity(m[1].str());
+            d.tool     = "cmake";
+            d.message  = m[2].str();
+        }
+        else if (std::regex_match(line, m, gnu_regex)) {
+            d.severity = to_severity(m[4].str());
+            d.tool     = "clang";
+            d.file     = m[1].str();
+            d.line     = to_int(m[2]);
+            d.column   = to_int(m[3]);
+            d.message  = m[5].str();
+
+            extract_clang_flag(d);
+        }
+        else if (std::regex_match(line, m, tool_regex)) {
+            d.severity = to_severity(m[2].str());
+            d.code     = m[3].str();
+            d.tool     = tool_for_code(d.code);
+            d.file     = m[1].str();
+            d.message  = m[4].str();
+
+            // `LINK : ` and `cl : ` are not files
+            if (d.file == "LINK" || d.file == "cl" || d.file == "MSBUILD")
+                d.file.clear();
+        }
+        else {
+            return {};
+        }
+
+        return d;
+    }
+
+    diagnostics& diagnostics::instance()
+    {
+        static diagnostics d;
+        return d;
+    }
+
+    process::filter_fun diagnostics::filter(const context& cx)
+    {
+        return [task = cx.task_name()](process::filter& f) {
+            auto d = diagnostic::parse(f.line);
+            if (!d)
+                return;
+
+            // warnings are only counted, there can be thousands of them
+            if (d->severity == diagnostic::error)
+                f.lv = context::level::error;
+
+            instance().add(task, std::move(*d));
+        };
+    }
+
+    void diagnostics::add(const std::string& task, diagnostic d)
+    {
+        // tools output paths with different cases and slashes
+        std::string file = d.file;
+        std::replace(file.begin(), file.end(), '/', '\\');
+        std::transform(file.begin(), file.end(), file.begin(), [](char c) {
+            return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        });
+
+        const auto key = std::format("{}|{}|{}|{}|{}|{}|{}", file, d.line, d.column,
+                                     static_cast<int>(d.severity), d.tool, d.code,
+                                     d.message);
+
+        std::scoped_lock lock(mutex_);
+
+        auto& e = entries_[key];
+
+        if (e.count == 0)
+            e.d = std::move(d);
+
+        ++e.count;
+
+        auto itor = std::lower_bound(e.tasks.begin(), e.tasks.end(), task);
+        if (itor == e.tasks.end() || *itor != task)
+            e.tasks.insert(itor, task);
+    }
+
+    std::map<std::string, diagnostics::counts> diagnostics::task_counts() const
+    {
+        std::scoped_lock lock(mutex_);
+        std::map<std::string, counts> map;
+
+        for (auto&& [_, e] : entries_) {
+            for (auto&& t : e.tasks) {
+                auto& c = map[t];
+
+                if (e.d.severity == diagnostic::error)
+                    ++c.errors;
+                else
+                    ++c.warnings;
+            }
+        }
+
+        return map;
+    }
+
+    void diagnostics::log_summary(const context& cx) const
+    {
+        const auto map = task_counts();
+        if (map.empty())
+            return;
+
+        std::vector<std::pair<std::string, std::string>> v;
+
+        for (auto&& [task, c] : map) {
+            v.push_back({task.empty() ? "(no task)" : task,
+                         std::format("{} warning(s), {} error(s)", c.warnings,
+                                     c.errors)});
+        }
+
+        cx.info(context::generic, "diagnostics:");
+
+        for_each_line(table(v, 2, 3), [&](auto&& line) {
+            cx.info(context::generic, "{}", line);
+        });
+    }
+
+    void diagnostics::write_report(const context& cx, const fs::path& p) const
+    {
+        nlohmann::json list = nlohmann::json::array();
+        std::size_t warnings = 0, errors = 0;
+
+        {
+            std::scoped_lock lock(mutex_);
+
+            for (auto&& [_, e] : entries_) {
+                const bool error = (e.d.severity == diagnostic::error);
+
+                if (error)
+                    ++errors;
+                else
+                    ++warnings;
+
+                list.push_back({{"severity", error ? "error" : "warning"},
+                                {"tool", e.d.tool},
+                                {"code", e.d.code},
+                                {"file", e.d.file},
+                                {"line", e.d.line},
+                                {"column", e.d.column},
+                                {"message", e.d.message},
+                                {"tasks", e.tasks},
+                                {"count", e.count}});
+            }
+        }
+
+        nlohmann::json tasks = nlohmann::json::object();
+
+        for (auto&& [task, c] : task_counts())
+            tasks[task] = {{"warnings", c.warnings}, {"errors", c.errors}};
+
+        const nlohmann::json json = {{"warnings", warnings},
+                                     {"errors", errors},
+                                     {"tasks", tasks},
+                                     {"diagnostics", list}};
+
+        cx.debug(context::generic, "writing {} diagnostics to {}", list.size(), p);
+
+        // global/diagnostics_file may be outside the prefix
+        op::create_directories(cx, p.parent_path(), op::optional | op::unsafe);
+        op::write_text_file(cx, encodings::utf8, p, json.dump(),
+                            op::optional | op::unsafe);
+    }
+
+}  // namespace mob
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "process.h"
+
+namespace mob {
+
+    // a warning or an error from the output of a build tool
+    //
+    struct diagnostic {
+        enum class severities { warning = 1, error };
+        using enum severities;
+
+        severities severity = warning;
+
+        // "msvc", "clang", "link", "msbuild" or "cmake"
+        std::string tool;
+
+        // something like "C4996", "LNK2019", "MSB3073" or "-Wunused-variable",
+        // may be empty
+        std::string code;
+
+        // file, line and column, may be empty/0
+        std::string file;
+        int line   = 0;
+        int column = 0;
+
+        std::string message;
+
+        // parses a single line of output, recognizes:
+        //
+        //   - msvc and clang-cl: `file(line,col): warning C4996: message`
+        //   - clang: `file:line:col: warning: message [-Wflag]`
+        //   - linker and msbuild: `file : error LNK2019: message`
+        //   - cmake: `CMake Warning at file:line (command):`
+        //
+        // the ` [project.vcxproj]` that msbuild appends to lines is ignored;
+        // returns empty for anything else
+        //
+        static std::optional<diagnostic> parse(std::string_view line);
+    };
+
+    // collects the diagnostics from all the processes that were given filter()
+    //
+    // the same diagnostic is often output more than once, such as a warning in
+    // a header included by multiple files or projects built in parallel, so
+    // they're deduplicated and only the unique ones are kept, along with the
+    // tasks that had them; the rest of the output is not stored
+    //
+    class diagnostics {
+    public:
+        // number of unique diagnostics
+        //
+        struct counts {
+            std::size_t warnings = 0;
+            std::size_t errors   = 0;
+        };
+
+        static diagnostics& instance();
+
+        // returns a filter for process::stdout_filter() and stderr_filter() that
+        // parses every line and adds the diagnostics to instance() for the task
+        // of the given context; the log level of errors is raised so they're
+        // visible on the console
+        //
+        static process::filter_fun filter(const context& cx);
+
+        // adds a diagnostic for the given task, thread-safe
+        //
+        void add(const std::string& task, diagnostic d);
+
+        // counts per task name
+        //
+        std::map<std::string, counts> task_counts() const;
+
+        // logs task_counts(), does nothing if there are no diagnostics
+        //
+        void log_summary(const context& cx) const;
+
+        // writes all the diagnostics as json
+        //
+        void write_report(const context& cx, const fs::path& p) const;
+
+    private:
+        struct entry {
+            diagnostic d;
+
+            // tasks that had this diagnostic, sorted
+            std::vector<std::string> tasks;
+
+            // total number of times it was seen
+            std::size_t count = 0;
+        };
+
+        mutable std::mutex mutex_;
+
+        // keyed by everything in the diagnostic, ordered so the report is
+        // stable
+        std::map<std::string, entry> entries_;
+    };
+
+}  // namespace mob
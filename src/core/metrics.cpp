@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "metrics.h"
+#include "context.h"
+
+namespace mob {
+
+    namespace {
+
+        // returns the value at the given percentile of a sorted vector, nearest
+        // rank
+        //
+        double percentile(const std::vector<double>& sorted, double p)
+        {
+            const auto rank = static_cast<std::size_t>(
+                std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+
+            return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+        }
+
+        nlohmann::json summarize(std::vector<double> v)
+        {
+            std::sort(v.begin(), v.end());
+
+            const double sum = std::accumulate(v.begin(), v.end(), 0.0);
+
+            return {{"count", v.size()},
+                    {"min", v.front()},
+                    {"max", v.back()},
+                    {"mean", sum / static_cast<double>(v.size())},
+                    {"p50", percentile(v, 50)},
+                    {"p90", percentile(v, 90)},
+                    {"p99", percentile(v, 99)}};
+        }
+
+        template <class Map>
+        auto& find_or_add(Map& m, std::string_view name)
+        {
+            auto itor = m.find(name);
+            if (itor == m.end())
+                itor = m.emplace(std::string(name), typename Map::mapped_type{}).first;
+
+            return itor->second;
+        }
+
+    }  // namespace
+
+    metrics& metrics::instance()
+    {
+        static metrics m;
+        return m;
+    }
+
+    void metrics::add(std::string_view name, std::uint64_t n)
+    {
+        add(name, {}, n);
+    }
+
+    void metrics::add(std::string_view name, std::string_view label, std::uint64_t n)
+    {
+        std::scoped_lock lock(mutex_);
+
+        auto& labels = find_or_add(counters_, name);
+        auto itor    = labels.find(std::string(label));
+
+        if (itor == labels.end())
+            labels.emplace(std::string(label), n);
+        else
+            itor->second += n;
+    }
+
+    void metrics::record(std::string_view name, double value)
+    {
+        std::scoped_lock lock(mutex_);
+        find_or_add(histograms_, name).push_back(value);
+    }
+
+    void metrics::gauge(std::string_view name, std::int64_t n)
+    {
+        std::scoped_lock lock(mutex_);
+
+        auto& g   = find_or_add(gauges_, name);
+        g.current += n;
+        g.peak    = std::max(g.peak, g.current);
+    }
+
+    void metrics::write(const context& cx, const fs::path& p) const
+    {
+        nlohmann::json counters   = nlohmann::json::object();
+        nlohmann::json histograms = nlohmann::json::object();
+        nlohmann::json gauges     = nlohmann::json::object();
+
+        {
+            std::scoped_lock lock(mutex_);
+
+            for (auto&& [name, labels] : counters_) {
+                // a single unlabelled value is written as a number
+                if (labels.size() == 1 && labels.begin()->first.empty()) {
+                    counters[name] = labels.begin()->second;
+                    continue;
+                }
+
+                auto& o = counters[name];
+                o       = nlohmann::json::object();
+
+                for (auto&& [label, n] : labels)
+                    o[label] = n;
+            }
+
+            for (auto&& [name, v] : histograms_)
+                histograms[name] = summarize(v);
+
+            for (auto&& [name, g] : gauges_)
+                gauges[name] = g.peak;
+        }
+
+        const nlohmann::json json = {
+            {"counters", counters}, {"histograms", histograms}, {"peaks", gauges}};
+
+        cx.info(context::generic, "writing metrics to {}", p);
+
+        // the file can be anywhere and is also written for dry runs, so this
+        // doesn't go through op::write_text_file()
+        std::error_code ec;
+        if (p.has_parent_path())
+            fs::create_directories(p.parent_path(), ec);
+
+        std::ofstream out(p, std::ios::binary);
+        out << json.dump(2);
+        out.close();
+
+        if (!out)
+            cx.error(context::generic, "can't write metrics to {}", p);
+    }
+
+}  // namespace mob
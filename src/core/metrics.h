@@ -0,0 +1,56 @@
+#pragma once
+
+namespace mob {
+
+    class context;
+
+    // counters and histograms gathered during a run, written as json with
+    // `--metrics PATH` for build and release
+    //
+    // names are dotted, like "process.spawned" or "copy.files_copied"; counters
+    // can have a label, like the tool name for "process.spawned", in which case
+    // they're written as an object with one value per label
+    //
+    // all functions are thread-safe and cheap enough to be called from anywhere,
+    // metrics are always gathered even if they're not written
+    //
+    class metrics {
+    public:
+        static metrics& instance();
+
+        // adds `n` to the given counter
+        //
+        void add(std::string_view name, std::uint64_t n = 1);
+        void add(std::string_view name, std::string_view label, std::uint64_t n = 1);
+
+        // adds a value to the given histogram
+        //
+        void record(std::string_view name, double value);
+
+        // adds `n` to a gauge and keeps its maximum value, like for the number of
+        // processes running concurrently; written as the maximum
+        //
+        void gauge(std::string_view name, std::int64_t n);
+
+        // writes everything to the given file as json; histograms are
+        // summarized as count, min, max, mean and percentiles
+        //
+        void write(const context& cx, const fs::path& p) const;
+
+    private:
+        struct gauge_value {
+            std::int64_t current = 0;
+            std::int64_t peak    = 0;
+        };
+
+        mutable std::mutex mutex_;
+
+        // labelled counters, unlabelled ones have an empty label
+        std::map<std::string, std::map<std::string, std::uint64_t>, std::less<>>
+            counters_;
+
+        std::map<std::string, std::vector<double>, std::less<>> histograms_;
+        std::map<std::string, gauge_value, std::less<>> gauges_;
+    };
+
+}  // namespace mob
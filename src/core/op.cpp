@@ -2,8 +2,10 @@
 #include "op.h"
 #include "../tools/tools.h"
 #include "../utility.h"
+#include "../utility/threading.h"
 #include "conf.h"
 #include "context.h"
+#include "metrics.h"
 
 namespace mob::op {
 
@@ -12,9 +14,11 @@ namespace mob::op {
     void do_touch(const context& cx, const fs::path& p);
     void do_create_directories(const context& cx, const fs::path& p);
     void do_delete_directory(const context& cx, const fs::path& p);
+    bool do_trash_directory(const context& cx, const fs::path& p);
     void do_delete_file(const context& cx, const fs::path& p);
     void do_copy_file_to_dir(const context& cx, const fs::path& f, const fs::path& d);
     void do_copy_file_to_file(const context& cx, const fs::path& f, const fs::path& d);
+    bool do_link_file(const context& cx, const fs::path& src, const fs::path& dest);
     void do_remove_readonly(const context& cx, const fs::path& p);
     void do_rename(const context& cx, const fs::path& src, const fs::path& dest);
 
@@ -22,6 +26,14 @@ namespace mob::op {
     //
     void check(const context& cx, const fs::path& p, flags f);
 
+    // whether `p` is `dir` or inside it, case insensitive
+    //
+    bool is_inside(const fs::path& p, const fs::path& dir);
+
+    // wakes up the trash reaper, starts it if necessary
+    //
+    void wake_trash_reaper();
+
     void touch(const context& cx, const fs::path& p, flags f)
     {
         cx.trace(context::fs, "touching {}", p);
@@ -59,8 +71,15 @@ namespace mob::op {
         if (fs::exists(p) && !fs::is_directory(p))
             cx.bail_out(context::fs, "{} is not a dir", p);
 
-        if (!conf().global().dry())
-            do_delete_directory(cx, p);
+        if (conf().global().dry())
+            return;
+
+        metrics::instance().add("fs.directories_deleted");
+
+        if (conf().global().trash_deletes() && do_trash_directory(cx, p))
+            return;
+
+        do_delete_directory(cx, p);
     }
 
     void delete_file(const context& cx, const fs::path& p, flags f)
@@ -250,12 +269,14 @@ namespace mob::op {
         const auto target = dir / file.filename();
         if (is_source_better(cx, file, target)) {
             cx.trace(context::fs, "{} -> {}", file, dir);
+            metrics::instance().add("copy.files_copied");
 
             if (!conf().global().dry())
                 do_copy_file_to_dir(cx, file, dir);
         }
         else {
             cx.trace(context::bypass, "(skipped) {} -> {}", file, dir);
+            metrics::instance().add("copy.files_skipped");
         }
     }
 
@@ -289,29 +310,261 @@ namespace mob::op {
 
         if (is_source_better(cx, src, dest)) {
             cx.trace(context::fs, "{} -> {}", src, dest);
+            metrics::instance().add("copy.files_copied");
 
             if (!conf().global().dry())
                 do_copy_file_to_file(cx, src, dest);
         }
         else {
             cx.trace(context::bypass, "(skipped) {} -> {}", src, dest);
+            metrics::instance().add("copy.files_skipped");
         }
     }
 
-    void copy_glob_to_dir_if_better(const context& cx, const fs::path& src_glob,
-                                    const fs::path& dest_dir, flags f)
+    namespace {
+
+        // a file matched by gather_glob()
+        //
+        struct glob_file {
+            fs::path src;
+            fs::path dest_dir;
+            std::uintmax_t size;
+            fs::file_time_type time;
+        };
+
+        // size and time of a file that already exists in a destination directory
+        //
+        struct dest_stat {
+            std::uintmax_t size;
+            fs::file_time_type time;
+        };
+
+        using dest_stats = std::unordered_map<std::wstring, dest_stat>;
+
+        // lowercase path, used as a key in dest_stats and the hash cache
+        //
+        std::wstring stat_key(const fs::path& filename)
+        {
+            std::wstring s = filename.native();
+            ::CharLowerBuffW(s.data(), static_cast<DWORD>(s.size()));
+            return s;
+        }
+
+        // lists all the files in `dir`, directory entries already contain the size
+        // and time, so this is a single listing instead of multiple calls per file
+        //
+        dest_stats stat_directory(const fs::path& dir)
+        {
+            dest_stats v;
+            std::error_code ec;
+
+            for (auto&& e : fs::directory_iterator(dir, ec)) {
+                if (!e.is_regular_file(ec))
+                    continue;
+
+                const auto size = e.file_size(ec);
+                if (ec)
+                    continue;
+
+                const auto time = e.last_write_time(ec);
+                if (ec)
+                    continue;
+
+                v.emplace(stat_key(e.path().filename()), dest_stat{size, time});
+            }
+
+            return v;
+        }
+
+    }  // namespace
+
+    // content hashes of files, only valid as long as the size and time of the file
+    // haven't changed; saved in the cache directory so files are only read again
+    // when they've changed
+    //
+    class hash_cache {
+    public:
+        static hash_cache& instance()
+        {
+            static hash_cache c;
+            return c;
+        }
+
+        // returns the hash of the given file, either from the cache or by reading
+        // it; returns empty if the file can't be read
+        //
+        std::optional<std::uint64_t> get(const context& cx, const fs::path& p,
+                                          std::uintmax_t size, fs::file_time_type time)
+        {
+            const auto key = utf16_to_utf8(stat_key(p));
+
+            {
+                std::scoped_lock lock(m_);
+                load(cx);
+
+                auto itor = map_.find(key);
+                if (itor != map_.end()) {
+                    const auto& e = itor->second;
+
+                    if (e.size == size && e.time == time.time_since_epoch().count()) {
+                        metrics::instance().add("cache.hits", "file_hash");
+                        return e.hash;
+                    }
+                }
+            }
+
+            metrics::instance().add("cache.misses", "file_hash");
+
+            const auto h = op::hash_file(cx, p);
+            if (!h)
+                return {};
+
+            {
+                std::scoped_lock lock(m_);
+                map_[key] = {size, time.time_since_epoch().count(), *h};
+                dirty_    = true;
+            }
+
+            return h;
+        }
+
+        // writes the cache if anything changed, entries for files that don't
+        // exist anymore are dropped
+        //
+        void save(const context& cx)
+        {
+            std::scoped_lock lock(m_);
+
+            if (!dirty_)
+                return;
+
+            std::erase_if(map_, [](auto&& kv) {
+                std::error_code ec;
+                return !fs::exists(utf8_to_utf16(kv.first), ec);
+            });
+
+            nlohmann::json json = nlohmann::json::object();
+
+            for (auto&& [path, e] : map_)
+                json[path] = {{"size", e.size}, {"time", e.time}, {"hash", e.hash}};
+
+            const auto f = file();
+            cx.trace(context::fs, "saving {} hashes to {}", map_.size(), f);
+
+            op::create_directories(cx, f.parent_path());
+            op::write_text_file(cx, encodings::utf8, f, json.dump(), op::optional);
+
+            dirty_ = false;
+        }
+
+    private:
+        struct entry {
+            std::uintmax_t size;
+            fs::file_time_type::rep time;
+            std::uint64_t hash;
+        };
+
+        std::mutex m_;
+        bool loaded_ = false;
+        bool dirty_  = false;
+
+        // lowercase utf8 path to entry
+        std::unordered_map<std::string, entry> map_;
+
+        static fs::path file() { return conf().path().cache() / "mob-hashes.json"; }
+
+        void load(const context& cx)
+        {
+            if (loaded_)
+                return;
+
+            loaded_ = true;
+
+            const auto f = file();
+            if (!fs::exists(f))
+                return;
+
+            try {
+                const auto json = nlohmann::json::parse(
+                    op::read_text_file(cx, encodings::utf8, f, op::optional));
+
+                for (auto&& [path, e] : json.items()) {
+                    map_[path] = {e["size"].get<std::uintmax_t>(),
+                                  e["time"].get<fs::file_time_type::rep>(),
+                                  e["hash"].get<std::uint64_t>()};
+                }
+
+                cx.trace(context::fs, "loaded {} hashes from {}", map_.size(), f);
+            }
+            catch (nlohmann::json::exception& e) {
+                // a bad cache only means files will be hashed again
+                cx.warning(context::fs, "ignoring bad hash cache {}, {}", f, e.what());
+                map_.clear();
+            }
+        }
+    };
+
+    // same as is_source_better(), but uses the size and time gathered while
+    // listing directories instead of asking for them again; `dest` is null if
+    // the target doesn't exist
+    //
+    // if global/copy_hash is true and the source is newer but has the same size,
+    // the content of both files is compared before deciding
+    //
+    bool is_source_better(const context& cx, const glob_file& src,
+                          const dest_stat* dest, const fs::path& target)
     {
-        check(cx, dest_dir, f);
+        if (!dest) {
+            cx.trace(context::fs, "target {} doesn't exist; copying", target);
+            return true;
+        }
 
-        const auto file_parent = src_glob.parent_path();
-        const auto wildcard    = src_glob.filename().native();
+        if (src.size != dest->size) {
+            cx.trace(context::fs, "src {} bytes, dest {} bytes; different, copying",
+                     src.size, dest->size);
 
-        if (!fs::exists(file_parent)) {
-            cx.bail_out(context::fs,
-                        "can't copy glob {} to {}, parent directory {} doesn't exist",
-                        src_glob, dest_dir, file_parent);
+            return true;
+        }
+
+        if (src.time <= dest->time) {
+            // same size, same date
+            return false;
+        }
+
+        if (!conf().global().copy_hash()) {
+            cx.trace(context::fs, "src {} is newer than dest {}; copying", src.src,
+                     target);
+
+            return true;
+        }
+
+        auto& hc          = hash_cache::instance();
+        const auto src_h  = hc.get(cx, src.src, src.size, src.time);
+        const auto dest_h = hc.get(cx, target, dest->size, dest->time);
+
+        if (src_h && dest_h && *src_h == *dest_h) {
+            cx.trace(context::fs,
+                     "src {} is newer than dest {} but has the same content", src.src,
+                     target);
+
+            return false;
         }
 
+        cx.trace(context::fs, "src {} is newer than dest {}; copying", src.src, target);
+
+        return true;
+    }
+
+    // walks the glob recursively and fills `dirs` with the directories that must
+    // be created and `files` with the files that match
+    //
+    void gather_glob(const context& cx, const fs::path& src_glob,
+                     const fs::path& dest_dir, flags f, std::vector<fs::path>& dirs,
+                     std::vector<glob_file>& files)
+    {
+        const auto file_parent = src_glob.parent_path();
+        const auto wildcard    = src_glob.filename().native();
+
         for (auto&& e : fs::directory_iterator(file_parent)) {
             const auto name = e.path().filename().native();
 
@@ -323,7 +576,10 @@ namespace mob::op {
 
             if (e.is_regular_file()) {
                 if (f & copy_files) {
-                    copy_file_to_dir_if_better(cx, e.path(), dest_dir);
+                    // directory entries already have the size and time, this
+                    // doesn't hit the filesystem again
+                    files.push_back(
+                        {e.path(), dest_dir, e.file_size(), e.last_write_time()});
                 }
                 else {
                     cx.trace(context::fs, "file {} matched {} but files are not copied",
@@ -334,8 +590,8 @@ namespace mob::op {
                 if (f & copy_dirs) {
                     const fs::path sub = dest_dir / e.path().filename();
 
-                    create_directories(cx, sub);
-                    copy_glob_to_dir_if_better(cx, e.path() / "*", sub, f);
+                    dirs.push_back(sub);
+                    gather_glob(cx, e.path() / "*", sub, f, dirs, files);
                 }
                 else {
                     cx.trace(context::fs,
@@ -346,6 +602,127 @@ namespace mob::op {
         }
     }
 
+    // copies all the given files in parallel, bails out if any copy failed
+    //
+    void copy_files_parallel(const context& cx,
+                             const std::vector<const glob_file*>& files)
+    {
+        // copy_threads is 0 for one thread per core
+        const int conf_threads = conf().global().copy_threads();
+
+        std::size_t threads = (conf_threads > 0 ? static_cast<std::size_t>(conf_threads)
+                                                : std::thread::hardware_concurrency());
+
+        threads = std::clamp<std::size_t>(threads, 1, files.size());
+
+        cx.trace(context::fs, "copying {} files with {} threads", files.size(),
+                 threads);
+
+        std::atomic<std::size_t> next = 0;
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        {
+            // every thread takes the next file until they're all copied
+            thread_pool tp(threads);
+
+            for (std::size_t t = 0; t < threads; ++t) {
+                tp.add([&] {
+                    try {
+                        for (;;) {
+                            const auto i = next++;
+                            if (i >= files.size())
+                                break;
+
+                            do_copy_file_to_dir(cx, files[i]->src, files[i]->dest_dir);
+                        }
+                    }
+                    catch (...) {
+                        // bailed, but also filesystem_error from fs:: calls; this
+                        // must not escape the thread
+                        std::scoped_lock lock(error_mutex);
+
+                        if (!error)
+                            error = std::current_exception();
+
+                        // make the other threads stop
+                        next = files.size();
+                    }
+                });
+            }
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    void copy_glob_to_dir_if_better(const context& cx, const fs::path& src_glob,
+                                    const fs::path& dest_dir, flags f)
+    {
+        check(cx, dest_dir, f);
+
+        const auto file_parent = src_glob.parent_path();
+
+        if (!fs::exists(file_parent)) {
+            cx.bail_out(context::fs,
+                        "can't copy glob {} to {}, parent directory {} doesn't exist",
+                        src_glob, dest_dir, file_parent);
+        }
+
+        check(cx, file_parent, f);
+
+        // enumerates the whole tree once
+        std::vector<fs::path> dirs;
+        std::vector<glob_file> files;
+        gather_glob(cx, src_glob, dest_dir, f, dirs, files);
+
+        for (auto&& d : dirs)
+            create_directories(cx, d);
+
+        // one listing per destination directory
+        std::map<fs::path, dest_stats> stats;
+        std::vector<const glob_file*> to_copy;
+
+        for (auto&& gf : files) {
+            auto itor = stats.find(gf.dest_dir);
+            if (itor == stats.end())
+                itor = stats.emplace(gf.dest_dir, stat_directory(gf.dest_dir)).first;
+
+            const auto name   = gf.src.filename();
+            const auto target = gf.dest_dir / name;
+
+            auto dest_itor        = itor->second.find(stat_key(name));
+            const dest_stat* dest = nullptr;
+
+            if (dest_itor != itor->second.end())
+                dest = &dest_itor->second;
+
+            if (is_source_better(cx, gf, dest, target)) {
+                cx.trace(context::fs, "{} -> {}", gf.src, gf.dest_dir);
+                to_copy.push_back(&gf);
+            }
+            else {
+                cx.trace(context::bypass, "(skipped) {} -> {}", gf.src, gf.dest_dir);
+            }
+        }
+
+        auto& m = metrics::instance();
+        m.add("copy.files_copied", to_copy.size());
+        m.add("copy.files_skipped", files.size() - to_copy.size());
+
+        if (conf().global().copy_hash())
+            hash_cache::instance().save(cx);
+
+        if (to_copy.empty() || conf().global().dry())
+            return;
+
+        // the top directory is not in `dirs`, and the copy threads shouldn't race
+        // to create it
+        create_directories(cx, dest_dir);
+
+        copy_files_parallel(cx, to_copy);
+    }
+
     void replace_file(const context& cx, const fs::path& src, const fs::path& dest,
                       const fs::path& backup, flags f)
     {
@@ -383,6 +760,37 @@ namespace mob::op {
         op::rename(cx, dest, src);
     }
 
+    std::optional<std::uint64_t> hash_file(const context& cx, const fs::path& p)
+    {
+        cx.trace(context::fs, "hashing {}", p);
+
+        std::ifstream in(p, std::ios::binary);
+        if (!in) {
+            cx.debug(context::fs, "can't open {} for hashing", p);
+            return {};
+        }
+
+        std::uint64_t h = 14695981039346656037ull;
+        std::vector<char> buffer(1024 * 1024);
+
+        while (in) {
+            in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            const auto n = static_cast<std::size_t>(in.gcount());
+
+            for (std::size_t i = 0; i < n; ++i) {
+                h ^= static_cast<unsigned char>(buffer[i]);
+                h *= 1099511628211ull;
+            }
+        }
+
+        if (in.bad()) {
+            cx.debug(context::fs, "can't read {} for hashing", p);
+            return {};
+        }
+
+        return h;
+    }
+
     std::string read_text_file_impl(const context& cx, const fs::path& p, flags f)
     {
         cx.trace(context::fs, "reading {}", p);
@@ -452,7 +860,8 @@ namespace mob::op {
 
     void archive_from_glob(const context& cx, const fs::path& src_glob,
                            const fs::path& dest_file,
-                           const std::vector<std::string>& ignore, flags f)
+                           const std::vector<std::string>& ignore,
+                           const conf_archive& profile, std::size_t threads, flags f)
     {
         cx.trace(context::fs, "archiving {} into {}", src_glob, dest_file);
         check(cx, dest_file, f);
@@ -460,11 +869,12 @@ namespace mob::op {
         if (conf().global().dry())
             return;
 
-        archiver::create_from_glob(cx, dest_file, src_glob, ignore);
+        archiver::create_from_glob(cx, dest_file, src_glob, ignore, profile, threads);
     }
 
     void archive_from_files(const context& cx, const std::vector<fs::path>& files,
                             const fs::path& files_root, const fs::path& dest_file,
+                            const conf_archive& profile, std::size_t threads,
                             flags f)
     {
         check(cx, dest_file, f);
@@ -475,7 +885,197 @@ namespace mob::op {
         if (conf().global().dry())
             return;
 
-        archiver::create_from_files(cx, dest_file, files, files_root);
+        archiver::create_from_files(cx, dest_file, files, files_root, profile,
+                                    threads);
+    }
+
+    // deletes everything in trash_path() in a low priority thread, sleeps until
+    // wakeup() is called when there's nothing left
+    //
+    // a directory that can't be deleted completely, such as when a file is
+    // locked, is left alone until the next run
+    //
+    class trash_reaper {
+    public:
+        trash_reaper() : cx_("trash_reaper"), ready_(true), quit_(false)
+        {
+            thread_ = start_thread([&] {
+                thread_fun();
+            });
+        }
+
+        // stops the thread and joins
+        //
+        ~trash_reaper()
+        {
+            quit_ = true;
+            wakeup();
+
+            if (thread_.joinable())
+                thread_.join();
+        }
+
+        // non-copyable
+        trash_reaper(const trash_reaper&)            = delete;
+        trash_reaper& operator=(const trash_reaper&) = delete;
+
+        // forces the thread to go through the trash again
+        //
+        void wakeup()
+        {
+            {
+                std::scoped_lock lock(m_);
+                ready_ = true;
+            }
+
+            cv_.notify_one();
+        }
+
+    private:
+        context cx_;
+        std::thread thread_;
+        std::mutex m_;
+        std::condition_variable cv_;
+        bool ready_;
+        std::atomic<bool> quit_;
+
+        void thread_fun()
+        {
+            // lowers both cpu and io priority so the build isn't slowed down
+            ::SetThreadPriority(::GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+
+            while (!quit_) {
+                {
+                    std::unique_lock lock(m_);
+                    cv_.wait(lock, [&] {
+                        return ready_;
+                    });
+
+                    ready_ = false;
+                }
+
+                if (quit_)
+                    break;
+
+                // nothing in here can be allowed to escape the thread, the trash
+                // is just tried again on the next run
+                try {
+                    reap_all();
+                }
+                catch (std::exception& e) {
+                    cx_.debug(context::fs, "trash reaper failed, {}", e.what());
+                }
+            }
+
+            ::SetThreadPriority(::GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+        }
+
+        // deletes all the directories currently in the trash
+        //
+        void reap_all()
+        {
+            const auto trash = trash_path();
+
+            std::error_code ec;
+            std::vector<fs::path> v;
+
+            // incremented with an error_code, operator++ can throw
+            auto itor = fs::directory_iterator(trash, ec);
+            for (; !ec && itor != fs::directory_iterator(); itor.increment(ec))
+                v.push_back(itor->path());
+
+            if (ec) {
+                cx_.trace(context::fs, "can't list trash {}, {}", trash, ec.message());
+                return;
+            }
+
+            for (auto&& p : v) {
+                if (quit_)
+                    return;
+
+                cx_.trace(context::fs, "deleting trash {}", p);
+                reap(p);
+            }
+        }
+
+        // deletes the given path recursively, stops early if quit_ is set; links
+        // and junctions are deleted without following them
+        //
+        void reap(const fs::path& p)
+        {
+            std::error_code ec;
+
+            if (fs::symlink_status(p, ec).type() == fs::file_type::directory) {
+                auto itor = fs::directory_iterator(p, ec);
+
+                for (; !ec && itor != fs::directory_iterator(); itor.increment(ec)) {
+                    if (quit_)
+                        return;
+
+                    reap(itor->path());
+                }
+            }
+
+            // an error while listing is reported by remove() below, the
+            // directory isn't empty
+            ec.clear();
+            fs::remove(p, ec);
+
+            if (ec.value() == ERROR_ACCESS_DENIED) {
+                // readonly files, same as do_delete_directory()
+                fs::permissions(p, fs::perms::owner_write, fs::perm_options::add, ec);
+                fs::remove(p, ec);
+            }
+
+            if (ec)
+                cx_.trace(context::fs, "can't delete trash {}, {}", p, ec.message());
+        }
+    };
+
+    static std::unique_ptr<trash_reaper> g_trash_reaper;
+    static std::mutex g_trash_reaper_mutex;
+
+    fs::path trash_path()
+    {
+        return conf().path().prefix() / ".mob-trash";
+    }
+
+    void start_trash_reaper(const context& cx)
+    {
+        if (conf().global().dry())
+            return;
+
+        const auto trash = trash_path();
+
+        std::error_code ec;
+        if (!fs::exists(trash, ec) || fs::is_empty(trash, ec))
+            return;
+
+        cx.debug(context::fs, "resuming deletion of leftover trash in {}", trash);
+        wake_trash_reaper();
+    }
+
+    void stop_trash_reaper()
+    {
+        std::unique_ptr<trash_reaper> r;
+
+        {
+            std::scoped_lock lock(g_trash_reaper_mutex);
+            r = std::move(g_trash_reaper);
+        }
+
+        // joins in the destructor, outside the lock
+        r.reset();
+    }
+
+    void wake_trash_reaper()
+    {
+        std::scoped_lock lock(g_trash_reaper_mutex);
+
+        if (g_trash_reaper)
+            g_trash_reaper->wakeup();
+        else
+            g_trash_reaper = std::make_unique<trash_reaper>();
     }
 
     void do_touch(const context& cx, const fs::path& p)
@@ -519,6 +1119,48 @@ namespace mob::op {
         }
     }
 
+    bool do_trash_directory(const context& cx, const fs::path& p)
+    {
+        const auto trash = trash_path();
+
+        // the trash itself or one of its parents, like the prefix, can't be moved
+        // into the trash
+        if (is_inside(trash, p)) {
+            cx.trace(context::fs, "{} contains the trash, deleting normally", p);
+            return false;
+        }
+
+        // unique name in case the same directory is deleted multiple times, or
+        // there's trash left over from a previous run
+        static std::atomic<std::size_t> counter = 0;
+        fs::path target;
+
+        do {
+            target = trash / std::format("{}-{}-{}", path_to_utf8(p.filename()),
+                                         GetCurrentProcessId(), counter++);
+        } while (fs::exists(target));
+
+        check(cx, target, noflags);
+
+        std::error_code ec;
+        fs::create_directories(trash, ec);
+
+        if (!ec)
+            fs::rename(p, target, ec);
+
+        if (ec) {
+            cx.debug(context::fs, "can't move {} to trash {}, {}; deleting normally",
+                     p, target, ec.message());
+
+            return false;
+        }
+
+        cx.trace(context::fs, "moved {} to trash {}", p, target);
+        wake_trash_reaper();
+
+        return true;
+    }
+
     void do_delete_file(const context& cx, const fs::path& p)
     {
         std::error_code ec;
@@ -533,6 +1175,9 @@ namespace mob::op {
         if (!fs::exists(d))
             op::create_directories(cx, d);
 
+        if (do_link_file(cx, f, d / f.filename()))
+            return;
+
         std::error_code ec;
         fs::copy_file(f, d / f.filename(), fs::copy_options::overwrite_existing, ec);
 
@@ -546,6 +1191,9 @@ namespace mob::op {
     {
         op::create_directories(cx, dest.parent_path());
 
+        if (do_link_file(cx, src, dest))
+            return;
+
         std::error_code ec;
         fs::copy_file(src, dest, fs::copy_options::overwrite_existing, ec);
 
@@ -555,6 +1203,191 @@ namespace mob::op {
         }
     }
 
+    // creates `dest` as a hard link to `src`, overwriting it; returns false if the
+    // link can't be created, such as when both paths are on different volumes
+    //
+    bool do_hardlink_file(const context& cx, const fs::path& src,
+                          const fs::path& dest)
+    {
+        std::error_code ec;
+
+        if (fs::exists(dest, ec)) {
+            // already linked
+            if (fs::equivalent(src, dest, ec))
+                return true;
+
+            // links can't overwrite files
+            fs::remove(dest, ec);
+        }
+
+        fs::create_hard_link(src, dest, ec);
+
+        if (ec) {
+            cx.trace(context::fs, "can't hard link {} to {}, {}; copying", src, dest,
+                     ec.message());
+
+            return false;
+        }
+
+        cx.trace(context::fs, "hard linked {} to {}", src, dest);
+        return true;
+    }
+
+    // creates `dest` as a clone of `src` with FSCTL_DUPLICATE_EXTENTS_TO_FILE,
+    // overwriting it; both files share the same blocks on disk until one of them
+    // is modified
+    //
+    // returns false if the file can't be cloned, which happens when the volume
+    // doesn't support block cloning (only ReFS and Dev Drives do) or when both
+    // paths are on different volumes
+    //
+    bool do_reflink_file(const context& cx, const fs::path& src, const fs::path& dest)
+    {
+        handle_ptr out;
+
+        auto fail = [&](std::string_view what) {
+            const auto e = GetLastError();
+
+            cx.trace(context::fs, "can't clone {} to {}, {} failed, {}; copying", src,
+                     dest, what, error_message(e));
+
+            // don't leave a partial file behind
+            if (out) {
+                out.reset();
+
+                std::error_code ec;
+                fs::remove(dest, ec);
+            }
+
+            return false;
+        };
+
+        handle_ptr in(::CreateFileW(src.native().c_str(), GENERIC_READ,
+                                    FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, 0));
+
+        if (in.get() == INVALID_HANDLE_VALUE)
+            return fail("opening source");
+
+        FILE_BASIC_INFO basic = {};
+        if (!::GetFileInformationByHandleEx(in.get(), FileBasicInfo, &basic,
+                                            sizeof(basic))) {
+            return fail("getting source info");
+        }
+
+        LARGE_INTEGER size = {};
+        if (!::GetFileSizeEx(in.get(), &size))
+            return fail("getting source size");
+
+        // cloned regions must be aligned on clusters
+        wchar_t volume[MAX_PATH + 1] = {};
+        DWORD sectors = 0, bytes = 0, free_clusters = 0, total_clusters = 0;
+
+        if (!::GetVolumePathNameW(src.native().c_str(), volume, MAX_PATH) ||
+            !::GetDiskFreeSpaceW(volume, &sectors, &bytes, &free_clusters,
+                                 &total_clusters)) {
+            return fail("getting cluster size");
+        }
+
+        const LONGLONG cluster = static_cast<LONGLONG>(sectors) * bytes;
+
+        out.reset(::CreateFileW(dest.native().c_str(), GENERIC_READ | GENERIC_WRITE,
+                                0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0));
+
+        if (out.get() == INVALID_HANDLE_VALUE) {
+            out.release();
+            return fail("creating target");
+        }
+
+        DWORD ioctl_bytes = 0;
+
+        // the target must be sparse if the source is
+        if (basic.FileAttributes & FILE_ATTRIBUTE_SPARSE_FILE) {
+            if (!::DeviceIoControl(out.get(), FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0,
+                                   &ioctl_bytes, nullptr)) {
+                return fail("setting sparse");
+            }
+        }
+
+        // the target must already have the right size
+        FILE_END_OF_FILE_INFO eof = {};
+        eof.EndOfFile             = size;
+
+        if (!::SetFileInformationByHandle(out.get(), FileEndOfFileInfo, &eof,
+                                          sizeof(eof))) {
+            return fail("setting target size");
+        }
+
+        // a single call can't clone more than 4GB, 1GB is a multiple of any
+        // cluster size
+        const LONGLONG max_chunk = 1ll << 30;
+
+        DUPLICATE_EXTENTS_DATA dup = {};
+        dup.FileHandle             = in.get();
+
+        for (LONGLONG offset = 0; offset < size.QuadPart; offset += max_chunk) {
+            const LONGLONG remaining = size.QuadPart - offset;
+
+            dup.SourceFileOffset.QuadPart = offset;
+            dup.TargetFileOffset.QuadPart = offset;
+
+            // the last region is rounded up to a full cluster
+            dup.ByteCount.QuadPart =
+                std::min(max_chunk, (remaining + cluster - 1) / cluster * cluster);
+
+            if (!::DeviceIoControl(out.get(), FSCTL_DUPLICATE_EXTENTS_TO_FILE, &dup,
+                                   sizeof(dup), nullptr, 0, &ioctl_bytes, nullptr)) {
+                return fail("cloning");
+            }
+        }
+
+        // same timestamps and attributes as a copy, is_source_better() relies on
+        // the time
+        if (!::SetFileInformationByHandle(out.get(), FileBasicInfo, &basic,
+                                          sizeof(basic))) {
+            return fail("setting target info");
+        }
+
+        cx.trace(context::fs, "cloned {} to {}", src, dest);
+        return true;
+    }
+
+    // links or clones `src` into `dest` depending on global/copy_mode; returns
+    // false if the file should be copied normally instead
+    //
+    // only files installed in the prefix are linked, copies anywhere else, like
+    // in temp directories or build directories, are always real copies
+    //
+    bool do_link_file(const context& cx, const fs::path& src, const fs::path& dest)
+    {
+        const auto mode = conf().global().copy_mode();
+
+        if (mode == conf_global::copy_modes::copy)
+            return false;
+
+        // only files installed into install/ are linked; build directories are
+        // also inside the prefix, but they must be real copies, and so must
+        // temporary files in case install/ is configured to contain them
+        const auto& paths = conf().path();
+
+        if (!is_inside(dest, paths.install()) || is_inside(dest, paths.build()) ||
+            is_inside(dest, paths.temp_dir())) {
+            return false;
+        }
+
+        switch (mode) {
+        case conf_global::copy_modes::hardlink:
+            return do_hardlink_file(cx, src, dest);
+
+        case conf_global::copy_modes::reflink:
+            return do_reflink_file(cx, src, dest);
+
+        case conf_global::copy_modes::copy:
+        default:
+            return false;
+        }
+    }
+
     void do_remove_readonly(const context& cx, const fs::path& p)
     {
         cx.trace(context::fs, "chmod +x {}", p);
@@ -587,21 +1420,6 @@ namespace mob::op {
         if (is_set(f, unsafe))
             return;
 
-        auto is_inside = [](auto&& p, auto&& dir) {
-            const std::string s      = path_to_utf8(p);
-            const std::string prefix = path_to_utf8(dir);
-
-            if (s.size() < prefix.size())
-                return false;
-
-            const std::string scut = s.substr(0, prefix.size());
-
-            if (_stricmp(scut.c_str(), prefix.c_str()) != 0)
-                return false;
-
-            return true;
-        };
-
         if (is_inside(p, conf().path().prefix()))
             return;
 
@@ -614,4 +1432,20 @@ namespace mob::op {
         cx.bail_out(context::fs, "path {} is outside prefix", p);
     }
 
+    bool is_inside(const fs::path& p, const fs::path& dir)
+    {
+        const std::string s      = path_to_utf8(p);
+        const std::string prefix = path_to_utf8(dir);
+
+        if (s.size() < prefix.size())
+            return false;
+
+        const std::string scut = s.substr(0, prefix.size());
+
+        if (_stricmp(scut.c_str(), prefix.c_str()) != 0)
+            return false;
+
+        return true;
+    }
+
 }  // namespace mob::op
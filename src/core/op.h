@@ -4,6 +4,7 @@
 
 namespace mob {
     class context;
+    class conf_archive;
 }
 
 namespace mob::op {
@@ -15,6 +16,11 @@ namespace mob::op {
     //   1) the destination doesn't exist, or
     //   2) the size is different, or
     //   3) the date is newer
+    //
+    // the copy functions create files according to global/copy_mode, which can
+    // hard link or clone files instead of copying them; this only applies to
+    // files created inside the install directory, everything else, including
+    // build and temp directories, is always copied
 
     // various flags for the operations below, only some of them are used by some
     // functions
@@ -55,6 +61,11 @@ namespace mob::op {
     // if the directory is controlled by git, prefer git_wrap::delete_directory(),
     // which checks for uncommitted changes before
     //
+    // if global/trash_deletes is true, the directory is renamed into trash_path()
+    // instead and deleted later by the trash reaper (see start_trash_reaper()
+    // below), which returns immediately; if the rename fails, such as when the
+    // directory is on a different volume, it is deleted normally
+    //
     void delete_directory(const context& cx, const fs::path& p, flags f = noflags);
 
     // deletes the given file
@@ -96,6 +107,11 @@ namespace mob::op {
     // basically calls copy_file_to_dir_if_better() for every file matching the
     // glob; recursive
     //
+    // the source tree and each target directory are only listed once, files that
+    // need to be copied are then copied in parallel, see global/copy_threads; if
+    // global/copy_hash is true, files that are newer but have the same size are
+    // compared by content and skipped if they're identical
+    //
     void copy_glob_to_dir_if_better(const context& cx, const fs::path& src_glob,
                                     const fs::path& dest_dir, flags f);
 
@@ -108,6 +124,12 @@ namespace mob::op {
     void replace_file(const context& cx, const fs::path& src, const fs::path& dest,
                       const fs::path& backup = {}, flags f = noflags);
 
+    // 64-bit fnv-1a of the file content, this is not meant to be secure, it's
+    // just to detect files that have been rewritten with the same content;
+    // returns empty if the file can't be read
+    //
+    std::optional<std::uint64_t> hash_file(const context& cx, const fs::path& p);
+
     // reads the given file, converts it to utf8 from the given encoding, returns
     // the utf8 string; if `e` is `dont_know`, returns the bytes as-is
     //
@@ -123,17 +145,40 @@ namespace mob::op {
     // creates an archive `dest_file` and puts all the files matching `src_glob`
     // into it, ignoring any file in `ignore` by name
     //
-    // uses tools::archiver
+    // uses tools::archiver with the format and compression settings from
+    // `profile`; the archiver may use up to `threads` threads, 0 to use the
+    // profile's thread count
     //
     void archive_from_glob(const context& cx, const fs::path& src_glob,
                            const fs::path& dest_file,
-                           const std::vector<std::string>& ignore, flags f = noflags);
+                           const std::vector<std::string>& ignore,
+                           const conf_archive& profile, std::size_t threads = 0,
+                           flags f = noflags);
 
     // creates an archive `dest_file` and puts all the files from `files` in it,
-    // resolving relative paths against `files_root`
+    // resolving relative paths against `files_root`; see archive_from_glob() for
+    // `profile` and `threads`
     //
     void archive_from_files(const context& cx, const std::vector<fs::path>& files,
                             const fs::path& files_root, const fs::path& dest_file,
+                            const conf_archive& profile, std::size_t threads = 0,
                             flags f = noflags);
 
+    // directory inside the prefix where delete_directory() moves directories
+    // when global/trash_deletes is true
+    //
+    fs::path trash_path();
+
+    // starts the trash reaper if trash_path() is not empty, which picks up
+    // directories left over by a previous run; the reaper is a low priority thread
+    // that deletes everything in trash_path() and is also started automatically
+    // by delete_directory() when it moves something into the trash
+    //
+    void start_trash_reaper(const context& cx);
+
+    // stops the trash reaper and waits for it; whatever wasn't deleted yet stays
+    // in trash_path() until the next call to start_trash_reaper()
+    //
+    void stop_trash_reaper();
+
 }  // namespace mob::op
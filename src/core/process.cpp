@@ -3,6 +3,7 @@
 #include "../net.h"
 #include "conf.h"
 #include "context.h"
+#include "metrics.h"
 #include "op.h"
 #include "pipe.h"
 
@@ -44,7 +45,7 @@ namespace mob {
     {
     }
 
-    process::exec::exec() : code(0)
+    process::exec::exec() : code(0), timeout(0), timed_out(false)
     {
         // default success exit code is just 0
         success.insert(0);
@@ -202,6 +203,12 @@ namespace mob {
         return flags_;
     }
 
+    process& process::timeout(std::chrono::milliseconds ms)
+    {
+        exec_.timeout = ms;
+        return *this;
+    }
+
     process& process::success_exit_codes(const std::set<int>& v)
     {
         exec_.success = v;
@@ -214,6 +221,11 @@ namespace mob {
         return *this;
     }
 
+    std::string process::command_line() const
+    {
+        return make_cmd();
+    }
+
     std::string process::make_name() const
     {
         if (!name().empty())
@@ -401,11 +413,16 @@ namespace mob {
 
         // creating process
         PROCESS_INFORMATION pi = {};
+        const auto spawn_start = hr_clock::now();
+
         const auto r =
             ::CreateProcessW(cmd.c_str(), args.data(), nullptr, nullptr,
                              TRUE,  // inherit handles
                              flags, exec_.env.get_unicode_pointers(), cwd_p, &si, &pi);
 
+        const std::chrono::duration<double, std::milli> spawn_time =
+            hr_clock::now() - spawn_start;
+
         if (!r) {
             const auto e = GetLastError();
             cx_->bail_out(context::cmd, "failed to start '{}', {}", args,
@@ -424,6 +441,15 @@ namespace mob {
 
         cx_->trace(context::cmd, "pid {}", pi.dwProcessId);
 
+        // the gauge is decremented in join()
+        auto& m = metrics::instance();
+        m.add("process.spawned", name().empty() ? "(unnamed)" : name());
+        m.record("process.spawn_ms", spawn_time.count());
+        m.gauge("process.concurrent", 1);
+
+        exec_.started   = hr_clock::now();
+        exec_.timed_out = false;
+
         // not needed
         ::CloseHandle(pi.hThread);
 
@@ -474,6 +500,7 @@ namespace mob {
         // close the handle quickly after termination
         guard g([&] {
             impl_.handle = {};
+            metrics::instance().gauge("process.concurrent", -1);
         });
 
         cx_->trace(context::cmd, "joining");
@@ -514,6 +541,28 @@ namespace mob {
 
         if (!already_interrupted)
             already_interrupted = check_interrupted();
+
+        // terminating sets the exit code, so the process will be considered
+        // failed in on_completed()
+        if (!already_interrupted)
+            already_interrupted = check_timed_out();
+    }
+
+    bool process::check_timed_out()
+    {
+        if (exec_.timeout.count() == 0 || exec_.timed_out)
+            return false;
+
+        if (hr_clock::now() - exec_.started < exec_.timeout)
+            return false;
+
+        cx_->debug(context::cmd, "process timed out after {}ms, terminating",
+                   exec_.timeout.count());
+
+        exec_.timed_out = true;
+        terminate();
+
+        return true;
     }
 
     void process::read_pipes(bool finish)
@@ -534,7 +583,7 @@ namespace mob {
             s.buffer.add(pipe.read(finish));
 
             // for each line in the buffer
-            s.buffer.next_utf8_lines(finish, [&](std::string&& line) {
+            s.buffer.next_utf8_lines(finish, [&](std::string_view line) {
                 // filter it, if there's a callback
                 filter f(line, r, s.level);
 
@@ -549,9 +598,10 @@ namespace mob {
                 if (!is_set(flags_, ignore_output_on_success))
                     cx_->log_string(f.r, f.lv, f.line);
 
-                // remember this log line, can be dumped after the process
-                // terminates
-                io_.logs[f.lv].emplace_back(std::move(line));
+                // remember warnings and errors, they're dumped after the process
+                // terminates; the rest of the output isn't needed
+                if (f.lv >= context::level::warning)
+                    io_.logs[f.lv].emplace_back(line);
             });
 
             break;
@@ -678,6 +728,12 @@ namespace mob {
         else {
             dump_error_log_file();
             dump_stderr();
+
+            if (exec_.timed_out) {
+                cx_->bail_out(context::cmd, "{} timed out after {}ms", make_name(),
+                              exec_.timeout.count());
+            }
+
             cx_->bail_out(context::cmd, "{} returned {}", make_name(), exec_.code);
         }
     }
@@ -798,6 +854,11 @@ namespace mob {
         return static_cast<int>(exec_.code);
     }
 
+    bool process::timed_out() const
+    {
+        return exec_.timed_out;
+    }
+
     std::string process::stdout_string()
     {
         return io_.out.buffer.utf8_string();
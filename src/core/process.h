@@ -177,6 +177,11 @@ namespace mob {
         process& cwd(const fs::path& p);
         const fs::path& cwd() const;
 
+        // the full command line that run() would execute, quoted binary followed
+        // by the arguments, or the raw command line if one was set
+        //
+        std::string command_line() const;
+
         // process flags
         //
         process& flags(process_flags f);
@@ -243,6 +248,11 @@ namespace mob {
         //
         process& success_exit_codes(const std::set<int>& v);
 
+        // if the process is still running after this long, it's terminated in
+        // join() and considered failed; 0 for no timeout, the default
+        //
+        process& timeout(std::chrono::milliseconds ms);
+
         // adds an argument to the command line, see comment on top for conversions
         //
         template <class T, class = std::enable_if_t<!std::is_same_v<T, arg_flags>>>
@@ -318,6 +328,11 @@ namespace mob {
         //
         int exit_code() const;
 
+        // whether the process was terminated because it ran longer than
+        // timeout(), only valid after join() returns
+        //
+        bool timed_out() const;
+
         // content of stdout/stderr if keep_in_string is set
         //
         std::string stdout_string();
@@ -386,8 +401,9 @@ namespace mob {
             // see external_error_log()
             fs::path error_log_file;
 
-            // each line from the process is saved in this map so it can be output
-            // after the process has completed successfully but had stuff in stderr
+            // warnings and errors from the process are saved in this map so they
+            // can be output after the process has completed successfully but had
+            // stuff in stderr
             std::map<context::level, std::vector<std::string>> logs;
 
             io();
@@ -412,6 +428,15 @@ namespace mob {
             // exit code
             DWORD code;
 
+            // see timeout(), 0 for none
+            std::chrono::milliseconds timeout;
+
+            // when the process was spawned, for timeout()
+            hr_clock::time_point started;
+
+            // whether the process was terminated after the timeout
+            bool timed_out;
+
             exec();
         };
 
@@ -478,6 +503,11 @@ namespace mob {
         //
         void on_timeout(bool& already_interrupted);
 
+        // called from on_timeout(), terminates the process if it's been running
+        // longer than timeout(); returns true if it was terminated
+        //
+        bool check_timed_out();
+
         // reads from stdin and stderr, `finish` must be true when the process has
         // terminated
         //
@@ -76,6 +76,10 @@ namespace mob {
             .add_task<mo>({"modorganizer-preview_dds", "ddspreview"})
             .add_task<mo>({"modorganizer", "organizer"});
 
+        // builds the mo projects above in one build graph if [cmake] super_build
+        // is set, does nothing otherwise
+        add_task<super_build>();
+
         // other tasks
         add_task<translations>();
         add_task<installer>();
@@ -2,6 +2,7 @@
 #include "net.h"
 #include "core/conf.h"
 #include "core/context.h"
+#include "core/metrics.h"
 #include "core/op.h"
 #include "utility.h"
 #include "utility/threading.h"
@@ -74,7 +75,8 @@ namespace mob {
     }
 
     curl_downloader::curl_downloader(const context* cx)
-        : cx_(cx ? *cx : gcx()), bytes_(0), interrupt_(false), ok_(false)
+        : cx_(cx ? *cx : gcx()), tee_(nullptr), bytes_(0), interrupt_(false),
+          ok_(false)
     {
     }
 
@@ -103,6 +105,12 @@ namespace mob {
         return *this;
     }
 
+    curl_downloader& curl_downloader::tee(byte_pipe* p)
+    {
+        tee_ = p;
+        return *this;
+    }
+
     curl_downloader& curl_downloader::start()
     {
         ok_ = false;
@@ -152,6 +160,13 @@ namespace mob {
     {
         cx_.trace(context::net, "curl: initializing {}", url_);
 
+        // the reader is told the transfer is finished whatever happens, with
+        // ok_ being false on failures and interruptions
+        guard close_tee([&] {
+            if (tee_)
+                tee_->close_write(ok_);
+        });
+
         auto* c = curl_easy_init();
         guard g([&] {
             curl_easy_cleanup(c);
@@ -187,6 +202,8 @@ namespace mob {
         const auto r = curl_easy_perform(c);
         cx_.trace(context::net, "curl: transfer finished {}", url_);
 
+        metrics::instance().add("net.bytes_downloaded", url_.string(), bytes_);
+
         if (file_) {
             ::FlushFileBuffers(file_.get());
             file_.reset();
@@ -255,8 +272,16 @@ namespace mob {
         else
             b = write_string(ptr, n);
 
-        if (!b)
+        if (!b) {
             interrupt_ = true;
+            return;
+        }
+
+        if (tee_ && !tee_->write(ptr, n)) {
+            // the reader doesn't want more, keep going without it
+            cx_.trace(context::net, "curl: pipe closed by reader, not teeing");
+            tee_ = nullptr;
+        }
 
         bytes_ += n;
     }
@@ -5,6 +5,7 @@
 namespace mob {
 
     class context;
+    class byte_pipe;
 
     // curl global init/cleanup
     //
@@ -59,6 +60,14 @@ namespace mob {
         //
         curl_downloader& header(std::string name, std::string value);
 
+        // everything that's downloaded is also written to the given pipe, which
+        // is closed when the transfer finishes; if the reader closes the pipe
+        // early, the download continues normally without it
+        //
+        // the pipe must live until join() returns, can be null to stop teeing
+        //
+        curl_downloader& tee(byte_pipe* p);
+
         // starts the download in a thread
         //
         curl_downloader& start();
@@ -85,6 +94,7 @@ namespace mob {
         mob::url url_;
         fs::path path_;
         handle_ptr file_;
+        byte_pipe* tee_;
         std::thread thread_;
         std::size_t bytes_;
         std::atomic<bool> interrupt_;
@@ -48,7 +48,12 @@
 
 #include <array>
 #include <atomic>
+#include <bit>
 #include <charconv>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <filesystem>
 #include <format>
 #include <fstream>
@@ -56,22 +61,28 @@
 #include <iostream>
 #include <map>
 #include <mutex>
+#include <numeric>
 #include <optional>
 #include <regex>
 #include <set>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <windows.h>
 
 #include <dbghelp.h>
+#include <emmintrin.h>
 #include <fcntl.h>
 #include <io.h>
 #include <shlobj.h>
 #include <shlwapi.h>
+#include <winioctl.h>
 
+#include <archive.h>
+#include <archive_entry.h>
 #include <clipp.h>
 #include <curl/curl.h>
 #include <nlohmann/json.hpp>
@@ -46,9 +46,13 @@ namespace mob::tasks {
 
     void explorerpp::do_fetch()
     {
-        const auto file = run_tool(downloader(source_url()));
+        // extracted while downloading when possible, the extractor only runs if
+        // the file was already in the cache or streaming failed
+        downloader dl(source_url());
+        const auto file = run_tool(dl.extract_to(source_path()));
 
-        run_tool(extractor().file(file).output(source_path()));
+        if (!dl.extracted())
+            run_tool(extractor().file(file).output(source_path()));
 
         // copy everything to install/bin/explorer++
         op::copy_glob_to_dir_if_better(cx(), source_path() / "*",
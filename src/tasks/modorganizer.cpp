@@ -125,7 +125,7 @@ namespace mob::tasks {
 
         // cmake clean
         if (is_set(c, clean::reconfigure))
-            run_tool(cmake(cmake::clean).root(source_path()));
+            run_tool(create_cmake_tool(cmake::clean));
     }
 
     void modorganizer::do_fetch()
@@ -175,30 +175,53 @@ namespace mob::tasks {
                            "{} has no CMakePresets.txt, aborting build", repo_);
         }
 
+        // the project is built with all the others in the super build
+        if (super_build::active()) {
+            cx().trace(context::generic, "{} will be built by super_build", repo_);
+            super_build::add(this);
+            return;
+        }
+
+        for (auto& step : build_steps(conf().global().jobs()))
+            run_tool(step);
+    }
+
+    std::vector<cmake> modorganizer::build_steps(int jobs) const
+    {
+        std::vector<cmake> steps;
+
         // run cmake
-        run_tool(cmake(cmake::generate)
-                     .generator(cmake::vs)
-                     .def("CMAKE_INSTALL_PREFIX:PATH", conf().path().install())
-                     .def("CMAKE_PREFIX_PATH", cmake_prefix_path())
-                     .configuration_types({task_conf().configuration()})
-                     .preset("vs2022-windows")
-                     .root(source_path()));
-
-        // run cmake --build with default target
-        // TODO: handle rebuild by adding `--clean-first`
-        // TODO: have a way to specify the `--parallel` value - 16 is useful to build
+        steps.push_back(
+            std::move(create_cmake_tool(cmake::generate)
+                          .def("CMAKE_INSTALL_PREFIX:PATH", conf().path().install())
+                          .def("CMAKE_PREFIX_PATH", cmake_prefix_path())
+                          .configuration_types({task_conf().configuration()})
+                          .preset("vs2022-windows")));
+
+        // run cmake --build with default target, jobs is useful to build
         // game_bethesda that has 15 games, so 15 projects
-        run_tool(cmake(cmake::build)
-                     .root(source_path())
-                     .arg("--parallel")
-                     .arg("16")
-                     .configuration(task_conf().configuration()));
-
-        // run cmake --install
-        run_tool(cmake(cmake::build)
-                     .root(source_path())
-                     .targets("INSTALL")
-                     .configuration(task_conf().configuration()));
+        // TODO: handle rebuild by adding `--clean-first`
+        steps.push_back(std::move(create_cmake_tool(cmake::build).jobs(jobs)));
+
+        // run cmake --install, the target is lowercase for ninja
+        const bool ninja = (cmake::generator_from_name(task_conf().cmake_generator()) ==
+                            cmake::ninja);
+
+        steps.push_back(std::move(create_cmake_tool(cmake::build)
+                                      .targets(ninja ? "install" : "INSTALL")
+                                      .jobs(jobs)));
+
+        return steps;
+    }
+
+    cmake modorganizer::create_cmake_tool(cmake::ops o) const
+    {
+        return std::move(
+            cmake(o)
+                .generator(cmake::generator_from_name(task_conf().cmake_generator()))
+                .configuration(task_conf().configuration())
+                .compiler_cache(true)
+                .root(source_path()));
     }
 
 }  // namespace mob::tasks
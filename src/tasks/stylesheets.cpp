@@ -66,11 +66,15 @@ namespace mob::tasks {
 
     void stylesheets::do_fetch()
     {
-        // download and extract file for each release
+        // download and extract file for each release; the downloader extracts
+        // while downloading when it can, the extractor only runs if it didn't
         for (auto&& r : releases()) {
-            const auto file = run_tool(make_downloader_tool(r));
+            const auto dir  = release_build_path(r);
+            auto dl         = make_downloader_tool(r);
+            const auto file = run_tool(dl.extract_to(dir));
 
-            run_tool(extractor().file(file).output(release_build_path(r)));
+            if (!dl.extracted())
+                run_tool(extractor().file(file).output(dir));
         }
     }
 
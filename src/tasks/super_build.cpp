@@ -0,0 +1,358 @@
+#include "pch.h"
+#include "../core/diagnostics.h"
+#include "task_manager.h"
+#include "tasks.h"
+
+namespace mob::tasks {
+
+    // the super build replaces the sequential groups of modorganizer tasks from
+    // add_tasks() by a single build graph
+    //
+    // modorganizer projects use each other through the cmake config files they
+    // install in the prefix, so they can't just be added to one cmake project with
+    // add_subdirectory(); instead, the generated CMakeLists.txt has one custom
+    // target per project, which runs a script doing the same steps as
+    // modorganizer::build_steps()
+    //
+    // dependencies between the projects come from their find_package() calls, so
+    // projects that don't depend on each other are built in parallel instead of
+    // waiting for the rest of their group in add_tasks()
+    //
+    // global/jobs is shared between the projects: about sqrt(jobs) of them are
+    // built at the same time, each with its share of the jobs; the top-level
+    // build gets that number as --parallel, which is /m for msbuild, and ninja
+    // also puts the targets in a job pool of that size
+    //
+    // the output of each script goes to a log file in steps/, which is parsed
+    // once the build is finished so diagnostics are counted for the project's
+    // task instead of this one
+    //
+    // the modorganizer tasks still clone/pull their repo and add their submodule,
+    // but call super_build::add() instead of building when active() returns true;
+    // this task runs after all of them, see add_tasks()
+
+    namespace {
+
+        // find_package(mo2-something, the package name is captured
+        const std::regex find_package_regex(
+            R"(find_package\s*\(\s*(mo2-[A-Za-z0-9_-]+))", std::regex::icase);
+
+        // project(mo2-something, some projects name themselves after their
+        // package, like cmake_common
+        const std::regex project_regex(R"(project\s*\(\s*(mo2-[A-Za-z0-9_-]+))",
+                                       std::regex::icase);
+
+        // lowercase, with underscores replaced by dashes
+        //
+        std::string normalize_package(std::string s)
+        {
+            for (auto& c : s) {
+                if (c == '_')
+                    c = '-';
+                else
+                    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+
+            return s;
+        }
+
+        // adds the first group of all the matches of `re` in `s` to `v`, if
+        // they're not there already
+        //
+        void add_matches(std::vector<std::string>& v, const std::string& s,
+                         const std::regex& re)
+        {
+            auto itor = std::sregex_iterator(s.begin(), s.end(), re);
+
+            for (; itor != std::sregex_iterator(); ++itor) {
+                const auto p = normalize_package((*itor)[1].str());
+
+                if (std::find(v.begin(), v.end(), p) == v.end())
+                    v.push_back(p);
+            }
+        }
+
+        // calls f() with the path of every cmake file in the given directory,
+        // recursively, skipping hidden and build directories
+        //
+        template <class F>
+        void for_each_cmake_file(const fs::path& root, F&& f)
+        {
+            auto itor = fs::recursive_directory_iterator(root);
+
+            for (; itor != fs::recursive_directory_iterator(); ++itor) {
+                const auto name = path_to_utf8(itor->path().filename());
+
+                if (itor->is_directory()) {
+                    // .git, vsbuild, ninjabuild_32, etc.
+                    const bool build = (name.find("build") != std::string::npos);
+
+                    if (name.starts_with(".") || build)
+                        itor.disable_recursion_pending();
+
+                    continue;
+                }
+
+                if (name == "CMakeLists.txt" || itor->path().extension() == ".cmake")
+                    f(itor->path());
+            }
+        }
+
+    }  // namespace
+
+    std::vector<const modorganizer*> super_build::tasks_;
+    std::mutex super_build::mutex_;
+
+    super_build::super_build() : task("super_build") {}
+
+    bool super_build::active()
+    {
+        if (!conf().cmake().super_build())
+            return false;
+
+        const auto* t = task_manager::instance().find_one("super_build", false);
+        return (t && t->enabled());
+    }
+
+    void super_build::add(const modorganizer* t)
+    {
+        std::scoped_lock lock(mutex_);
+        tasks_.push_back(t);
+    }
+
+    fs::path super_build::source_path()
+    {
+        return conf().path().build() / "mob-super";
+    }
+
+    void super_build::do_clean(clean c)
+    {
+        // the project is generated on every build, only the build directory
+        // matters
+        if (is_set(c, clean::reconfigure))
+            op::delete_directory(cx(), source_path(), op::optional);
+    }
+
+    void super_build::do_build_and_install()
+    {
+        if (!conf().cmake().super_build()) {
+            cx().trace(context::generic, "[cmake] super_build is off, nothing to do");
+            return;
+        }
+
+        std::vector<const modorganizer*> tasks;
+
+        {
+            std::scoped_lock lock(mutex_);
+            tasks = tasks_;
+        }
+
+        if (tasks.empty()) {
+            cx().info(context::generic, "no projects to build");
+            return;
+        }
+
+        // tasks are added from multiple threads
+        std::sort(tasks.begin(), tasks.end(), [](auto&& a, auto&& b) {
+            return (a->name() < b->name());
+        });
+
+        // projects built at the same time and jobs given to each of them
+        const int total =
+            (conf().global().jobs() > 0
+                 ? conf().global().jobs()
+                 : std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+
+        const int pool = std::clamp(static_cast<int>(std::lround(std::sqrt(total))), 1,
+                                    static_cast<int>(tasks.size()));
+
+        const int jobs = std::max(1, total / pool);
+
+        cx().debug(context::generic, "building {} projects at a time with {} jobs each",
+                   pool, jobs);
+
+        std::vector<project> projects;
+        std::map<std::string, fs::path> scripts;
+        std::vector<cmake> steps;
+
+        for (const auto* t : tasks) {
+            project p{t};
+
+            // every name of the task, like "mo2-uibase" for
+            // {"uibase", "modorganizer-uibase"}
+            for (auto&& n : t->names())
+                p.provides.push_back(normalize_package("mo2-" + n));
+
+            for_each_cmake_file(t->source_path(), [&](const fs::path& f) {
+                const auto s = op::read_text_file(cx(), encodings::utf8, f);
+
+                add_matches(p.required, s, find_package_regex);
+
+                if (f.parent_path() == t->source_path())
+                    add_matches(p.provides, s, project_regex);
+            });
+
+            scripts[t->name()] = write_script(*t, jobs, steps);
+            projects.push_back(std::move(p));
+        }
+
+        write_cmakelists(projects, scripts, pool);
+
+        run_tool(create_cmake_tool(cmake::generate));
+
+        try {
+            run_tool(create_cmake_tool(cmake::build).jobs(pool));
+        }
+        catch (...) {
+            // the errors of the project that failed are in its log
+            collect_diagnostics(tasks);
+            throw;
+        }
+
+        collect_diagnostics(tasks);
+
+        // the scripts can't write the configure stamps, see cmake::script(); on
+        // failure, the projects that did configure will just do it again next
+        // time
+        for (auto& step : steps)
+            step.script_succeeded();
+    }
+
+    fs::path super_build::write_script(const modorganizer& t, int jobs,
+                                       std::vector<cmake>& steps)
+    {
+        const auto path = source_path() / "steps" / (t.name() + ".cmd");
+
+        // paths may have non-ascii characters, scripts are written in utf8; the
+        // steps are a subroutine so their output can be redirected at once
+        std::string s =
+            "@echo off\r\n"
+            "setlocal\r\n"
+            "chcp 65001 >nul\r\n"
+            "call :steps > \"" + path_to_utf8(log_path(t)) + "\" 2>&1\r\n"
+            "exit /b %errorlevel%\r\n"
+            "\r\n"
+            ":steps\r\n";
+
+        for (auto& step : t.build_steps(jobs)) {
+            s += step.script();
+            steps.push_back(std::move(step));
+        }
+
+        s += "exit /b 0\r\n";
+
+        op::create_directories(cx(), path.parent_path());
+        op::write_text_file(cx(), encodings::utf8, path, s);
+
+        return path;
+    }
+
+    fs::path super_build::log_path(const modorganizer& t)
+    {
+        return source_path() / "steps" / (t.name() + ".log");
+    }
+
+    void super_build::collect_diagnostics(const std::vector<const modorganizer*>& tasks)
+    {
+        for (const auto* t : tasks) {
+            const auto log = log_path(*t);
+
+            // projects that didn't run because a dependency failed
+            std::error_code ec;
+            if (!fs::exists(log, ec))
+                continue;
+
+            const auto s = op::read_text_file(cx(), encodings::utf8, log, op::optional);
+            std::size_t errors = 0;
+
+            for_each_line(s, [&](std::string_view line) {
+                auto d = diagnostic::parse(line);
+                if (!d)
+                    return;
+
+                if (d->severity == diagnostic::error) {
+                    cx().error(context::generic, "{}: {}", t->name(), line);
+                    ++errors;
+                }
+
+                diagnostics::instance().add(t->name(), std::move(*d));
+            });
+
+            if (errors > 0) {
+                cx().error(context::generic, "{} had {} error(s), see {}", t->name(),
+                           errors, log);
+            }
+        }
+    }
+
+    void super_build::write_cmakelists(const std::vector<project>& projects,
+                                       const std::map<std::string, fs::path>& scripts,
+                                       int pool)
+    {
+        // JOB_POOLS is only used by ninja, msbuild is limited by the --parallel
+        // given to the top-level build
+        std::string s =
+            "# generated by mob, changes will be overwritten\n"
+            "cmake_minimum_required(VERSION 3.16)\n"
+            "project(mob_super NONE)\n"
+            "\n"
+            "set_property(GLOBAL PROPERTY JOB_POOLS mob_projects=" +
+            std::to_string(pool) + ")\n";
+
+        for (auto&& p : projects) {
+            std::vector<std::string> depends;
+
+            for (auto&& r : p.required) {
+                for (auto&& other : projects) {
+                    if (other.task == p.task)
+                        continue;
+
+                    const auto& v = other.provides;
+                    if (std::find(v.begin(), v.end(), r) == v.end())
+                        continue;
+
+                    if (std::find(depends.begin(), depends.end(),
+                                  other.task->name()) == depends.end()) {
+                        depends.push_back(other.task->name());
+                    }
+                }
+            }
+
+            cx().debug(context::generic, "{} depends on: {}", p.task->name(),
+                       depends.empty() ? "nothing" : join(depends, ", "));
+
+            // bracket arguments so paths don't need escaping, the script path
+            // keeps its backslashes for cmd
+            auto source = path_to_utf8(p.task->source_path());
+            std::replace(source.begin(), source.end(), '\\', '/');
+
+            const auto script = path_to_utf8(scripts.at(p.task->name()));
+
+            // custom targets are always out of date, so the script runs on every
+            // build and the project's own build decides what to do
+            s += "\nadd_custom_target(" + p.task->name() + " ALL\n";
+            s += "    COMMAND cmd /c [==[" + script + "]==]\n";
+            s += "    WORKING_DIRECTORY [==[" + source + "]==]\n";
+            s += "    JOB_POOL mob_projects)\n";
+
+            if (!depends.empty()) {
+                s += "add_dependencies(" + p.task->name() + " " + join(depends, " ") +
+                     ")\n";
+            }
+        }
+
+        op::write_text_file(cx(), encodings::utf8, source_path() / "CMakeLists.txt",
+                            s);
+    }
+
+    cmake super_build::create_cmake_tool(cmake::ops o) const
+    {
+        return std::move(
+            cmake(o)
+                .generator(cmake::generator_from_name(task_conf().cmake_generator()))
+                .architecture(arch::x64)
+                .configuration(task_conf().configuration())
+                .root(source_path()));
+    }
+
+}  // namespace mob::tasks
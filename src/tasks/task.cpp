@@ -296,6 +296,9 @@ namespace mob {
         g.revert_ts_on_pull(task_conf().revert_ts());
         g.credentials(task_conf().git_user(), task_conf().git_email());
         g.shallow(task_conf().git_shallow());
+        g.filter(task_conf().git_filter());
+        g.sparse(split(task_conf().git_sparse(), " "));
+        g.mirror(task_conf().git_mirror());
 
         if (task_conf().set_origin_remote()) {
             g.remote(task_conf().remote_org(), task_conf().remote_key(),
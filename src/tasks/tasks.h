@@ -63,12 +63,19 @@ namespace mob::tasks {
         //
         static fs::path super_path();
 
-        // creates the same cmake tool as the one used to build the various MO
-        // projects, used internally, but also by the cmake command
+        // creates the cmake tool used to build this project, with the root,
+        // configuration and the generator from the task's cmake_generator option
         //
-        static cmake create_cmake_tool(const fs::path& root,
-                                       cmake::ops o  = cmake::generate,
-                                       config config = config::relwithdebinfo);
+        cmake create_cmake_tool(cmake::ops o = cmake::generate) const;
+
+        // the cmake tools that generate, build and install this project, in
+        // order; run by do_build_and_install(), or turned into scripts by the
+        // super_build task
+        //
+        // `jobs` is given to `cmake --build` as `--parallel`, 0 to let the tool
+        // decide
+        //
+        std::vector<cmake> build_steps(int jobs) const;
 
         // some mo tasks have more than one name, mostly because the transifex slugs
         // are different than the names on github; the std::string and const char*
@@ -106,6 +113,80 @@ namespace mob::tasks {
         std::string project_;
     };
 
+    // builds the modorganizer projects in a single cmake project, see
+    // super_build.cpp
+    //
+    class super_build : public task {
+    public:
+        super_build();
+
+        // whether modorganizer projects should call add() instead of building
+        // themselves: [cmake] super_build is set and this task is enabled
+        //
+        static bool active();
+
+        // adds a project to the super build, called by modorganizer tasks
+        // from their own thread
+        //
+        static void add(const modorganizer* t);
+
+        // directory of the generated cmake project, build/mob-super
+        //
+        static fs::path source_path();
+
+    protected:
+        void do_clean(clean c) override;
+        void do_build_and_install() override;
+
+    private:
+        // a modorganizer project in the super build
+        //
+        struct project {
+            const modorganizer* task;
+
+            // packages this project installs, such as "mo2-uibase"
+            std::vector<std::string> provides;
+
+            // packages given to find_package() by this project
+            std::vector<std::string> required;
+        };
+
+        // projects added with add()
+        static std::vector<const modorganizer*> tasks_;
+        static std::mutex mutex_;
+
+        // writes the script for the given project in steps/, returns its path;
+        // the script builds with `jobs` parallel jobs and redirects its output
+        // to log_path()
+        //
+        // the steps are added to `steps`, script_succeeded() is called on them
+        // once the build has succeeded
+        //
+        fs::path write_script(const modorganizer& t, int jobs,
+                              std::vector<cmake>& steps);
+
+        // writes CMakeLists.txt with one custom target per project, at most
+        // `pool` of them run at the same time with ninja
+        //
+        void write_cmakelists(const std::vector<project>& projects,
+                              const std::map<std::string, fs::path>& scripts,
+                              int pool);
+
+        // output of the script for the given project, in steps/
+        //
+        static fs::path log_path(const modorganizer& t);
+
+        // parses the log of every project and adds the diagnostics for their
+        // task, errors are logged; called when the build is finished, even if it
+        // failed
+        //
+        void collect_diagnostics(const std::vector<const modorganizer*>& tasks);
+
+        // creates the cmake tool for the generated project
+        //
+        cmake create_cmake_tool(cmake::ops o = cmake::generate) const;
+    };
+
     class stylesheets : public task {
     public:
         struct release {
@@ -222,9 +303,43 @@ namespace mob::tasks {
         void do_build_and_install() override;
 
     private:
+        // a .ts file used to compile a .qm file, as saved in the manifest
+        //
+        struct input {
+            std::uintmax_t size          = 0;
+            fs::file_time_type::rep time = 0;
+
+            // 0 if the file couldn't be read
+            std::uint64_t hash = 0;
+        };
+
+        // utf8 path of .ts files to their info
+        using inputs = std::map<std::string, input>;
+
+        // .qm filename to the inputs that were used to compile it
+        using manifest = std::map<std::string, inputs>;
+
         // copy builtin qt .qm files
         void copy_builtin_qt_translations(const projects::project& organizer_project,
                                           const fs::path& dest);
+
+        // file that remembers the inputs of every .qm file compiled by the last
+        // build, so only .qm files with changed inputs are compiled again
+        //
+        static fs::path manifest_file();
+
+        // returns an empty manifest if the file doesn't exist, is invalid or was
+        // created by another version of lrelease
+        //
+        manifest read_manifest(const std::string& lrelease_version);
+
+        void write_manifest(const manifest& m, const std::string& lrelease_version);
+
+        // gets the size and time of the given .ts files; the hash is taken from
+        // `old` if the file hasn't changed, or else the file is hashed again
+        //
+        inputs make_inputs(const std::vector<fs::path>& ts_files,
+                           const inputs* old);
     };
 
     class usvfs : public basic_task<usvfs> {
@@ -244,6 +359,10 @@ namespace mob::tasks {
         void fetch_from_source();
         void build_and_install_from_source();
 
+        // generator from the task's cmake_generator option
+        //
+        cmake::generators generator() const;
+
         cmake create_cmake_tool(arch, cmake::ops = cmake::generate) const;
         msbuild create_msbuild_tool(arch, msbuild::ops = msbuild::build,
                                     config = config::release) const;
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "../core/env.h"
+#include "../core/metrics.h"
 #include "../utility/threading.h"
 #include "task_manager.h"
 #include "tasks.h"
@@ -199,6 +200,8 @@ namespace mob::tasks {
         if (is_set(c, clean::rebuild)) {
             op::delete_file_glob(cx(), conf().path().install_translations() / "*.qm",
                                  op::optional);
+
+            op::delete_file(cx(), manifest_file(), op::optional);
         }
     }
 
@@ -254,8 +257,10 @@ namespace mob::tasks {
     void translations::do_build_and_install()
     {
         // 1) build the list of projects, languages and .ts files
-        // 2) run `lrelease` for every language in every project
-        // 3) copy builtin qt translations
+        // 2) run `lrelease` for every language in every project that has changed
+        //    since the last build
+        // 3) delete .qm files from the last build that don't have a .ts anymore
+        // 4) copy builtin qt translations
 
         const auto root = source_path() / "translations";
         const auto dest = conf().path().install_translations();
@@ -267,32 +272,196 @@ namespace mob::tasks {
         for (auto&& w : ps.warnings())
             cx().warning(context::generic, "{}", w);
 
+        // everything is compiled again if lrelease changes
+        const auto version = lrelease::version();
+        const auto old     = read_manifest(version);
+        manifest current;
+
         // run `lrelease` in a thread pool
         parallel_functions v;
 
+        // number of lrelease runs that succeeded, the manifest is only written if
+        // they all did
+        std::atomic<std::size_t> compiled = 0;
+
         // for each project
         for (auto& p : ps.get()) {
             // for each language
             for (auto& lg : p.langs) {
+                const auto qm = path_to_utf8(
+                    lrelease().project(p.name).sources(lg.ts_files).qm_file());
+
+                const auto itor = old.find(qm);
+                const inputs* prev = (itor == old.end() ? nullptr : &itor->second);
+
+                auto& in = current[qm];
+                in       = make_inputs(lg.ts_files, prev);
+
+                if (prev && fs::exists(dest / qm)) {
+                    // same files with the same hashes, the times are ignored
+                    // because transifex rewrites all the files when pulling
+                    const bool same = std::ranges::equal(
+                        in, *prev, [](auto&& a, auto&& b) {
+                            return a.first == b.first && a.second.hash != 0 &&
+                                   a.second.hash == b.second.hash;
+                        });
+
+                    if (same) {
+                        cx().trace(context::generic, "{} is up to date", qm);
+                        metrics::instance().add("cache.hits", "translations");
+                        continue;
+                    }
+                }
+
+                metrics::instance().add("cache.misses", "translations");
+
                 // add a functor that will run lrelease
                 v.push_back(
                     {lg.name + "." + p.name, [&] {
                          // run release for the given project name and list of .ts files
                          run_tool(
                              lrelease().project(p.name).sources(lg.ts_files).out(dest));
+
+                         ++compiled;
                      }});
             }
         }
 
+        cx().debug(context::generic, "{} translations up to date, compiling {}",
+                   current.size() - v.size(), v.size());
+
         // run all the functors in parallel
         parallel(v);
 
+        // a failure interrupts everything, but parallel() doesn't throw; the
+        // manifest would list .qm files that were never compiled
+        if (compiled != v.size()) {
+            cx().debug(context::generic,
+                       "only {} of {} translations compiled, not writing manifest",
+                       compiled.load(), v.size());
+
+            check_interrupted();
+            return;
+        }
+
+        // .qm files from the last build that weren't compiled this time
+        for (auto&& [qm, _] : old) {
+            if (!current.contains(qm)) {
+                cx().debug(context::generic, "deleting orphaned {}", qm);
+                op::delete_file(cx(), dest / qm, op::optional);
+            }
+        }
+
+        write_manifest(current, version);
+
         if (auto p = ps.find("organizer"))
             copy_builtin_qt_translations(*p, dest);
         else
             cx().bail_out(context::generic, "organizer project not found");
     }
 
+    fs::path translations::manifest_file()
+    {
+        return source_path() / "mob-manifest.json";
+    }
+
+    translations::manifest
+    translations::read_manifest(const std::string& lrelease_version)
+    {
+        const auto f = manifest_file();
+        if (!fs::exists(f))
+            return {};
+
+        manifest m;
+
+        try {
+            const auto json = nlohmann::json::parse(
+                op::read_text_file(cx(), encodings::utf8, f, op::optional));
+
+            if (json["lrelease"].get<std::string>() != lrelease_version) {
+                cx().debug(context::generic,
+                           "lrelease version has changed, rebuilding everything");
+
+                return {};
+            }
+
+            for (auto&& [qm, files] : json["outputs"].items()) {
+                auto& in = m[qm];
+
+                for (auto&& [ts, e] : files.items()) {
+                    in[ts] = {e["size"].get<std::uintmax_t>(),
+                              e["time"].get<fs::file_time_type::rep>(),
+                              e["hash"].get<std::uint64_t>()};
+                }
+            }
+        }
+        catch (nlohmann::json::exception& e) {
+            // a bad manifest only means everything is compiled again
+            cx().warning(context::generic, "ignoring bad manifest {}, {}", f,
+                         e.what());
+
+            return {};
+        }
+
+        return m;
+    }
+
+    void translations::write_manifest(const manifest& m,
+                                      const std::string& lrelease_version)
+    {
+        nlohmann::json outputs = nlohmann::json::object();
+
+        for (auto&& [qm, files] : m) {
+            auto& o = outputs[qm];
+            o       = nlohmann::json::object();
+
+            for (auto&& [ts, e] : files)
+                o[ts] = {{"size", e.size}, {"time", e.time}, {"hash", e.hash}};
+        }
+
+        nlohmann::json json = {{"lrelease", lrelease_version}, {"outputs", outputs}};
+
+        op::write_text_file(cx(), encodings::utf8, manifest_file(), json.dump(),
+                            op::optional);
+    }
+
+    translations::inputs
+    translations::make_inputs(const std::vector<fs::path>& ts_files, const inputs* old)
+    {
+        inputs v;
+
+        for (auto&& ts : ts_files) {
+            const auto key = path_to_utf8(ts);
+            std::error_code size_ec, time_ec;
+
+            input in;
+            in.size = fs::file_size(ts, size_ec);
+            in.time = fs::last_write_time(ts, time_ec).time_since_epoch().count();
+
+            if (size_ec || time_ec) {
+                // leaving the hash to 0 will force a rebuild
+                v[key] = in;
+                continue;
+            }
+
+            if (old) {
+                auto itor = old->find(key);
+
+                if (itor != old->end() && itor->second.size == in.size &&
+                    itor->second.time == in.time) {
+                    in.hash = itor->second.hash;
+                }
+            }
+
+            if (in.hash == 0)
+                in.hash = op::hash_file(cx(), ts).value_or(0);
+
+            v[key] = in;
+        }
+
+        return v;
+    }
+
     void translations::copy_builtin_qt_translations(const projects::project& p,
                                                     const fs::path& dest)
     {
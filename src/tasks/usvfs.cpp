@@ -46,11 +46,17 @@ namespace mob::tasks {
         }
 
         if (is_set(c, clean::rebuild)) {
-            // msbuild clean
-            run_tool(create_msbuild_tool(arch::x86, msbuild::clean,
-                                         task_conf().configuration()));
-            run_tool(create_msbuild_tool(arch::x64, msbuild::clean,
-                                         task_conf().configuration()));
+            if (generator() == cmake::ninja) {
+                run_tool(create_cmake_tool(arch::x86, cmake::build).targets("clean"));
+                run_tool(create_cmake_tool(arch::x64, cmake::build).targets("clean"));
+            }
+            else {
+                // msbuild clean
+                run_tool(create_msbuild_tool(arch::x86, msbuild::clean,
+                                             task_conf().configuration()));
+                run_tool(create_msbuild_tool(arch::x64, msbuild::clean,
+                                             task_conf().configuration()));
+            }
         }
     }
 
@@ -76,19 +82,37 @@ namespace mob::tasks {
     {
         run_tool(create_cmake_tool(arch::x64));
         run_tool(create_cmake_tool(arch::x86));
-        run_tool(create_msbuild_tool(arch::x64, msbuild::build,
-                                     task_conf().configuration()));
-        run_tool(create_msbuild_tool(arch::x86, msbuild::build,
-                                     task_conf().configuration()));
+
+        if (generator() == cmake::ninja) {
+            const int jobs = conf().global().jobs();
+            run_tool(create_cmake_tool(arch::x64, cmake::build).jobs(jobs));
+            run_tool(create_cmake_tool(arch::x86, cmake::build).jobs(jobs));
+        }
+        else {
+            run_tool(create_msbuild_tool(arch::x64, msbuild::build,
+                                         task_conf().configuration()));
+            run_tool(create_msbuild_tool(arch::x86, msbuild::build,
+                                         task_conf().configuration()));
+        }
+    }
+
+    cmake::generators usvfs::generator() const
+    {
+        return cmake::generator_from_name(task_conf().cmake_generator());
     }
 
     cmake usvfs::create_cmake_tool(arch a, cmake::ops o) const
     {
+        // the architecture is only used by ninja, for the vcvars environment and
+        // the build directory; visual studio gets it from the preset
         return std::move(
             cmake(o)
                 .root(source_path())
                 .def("CMAKE_INSTALL_PREFIX:PATH", conf().path().install())
-                .generator(cmake::vs)
+                .generator(generator())
+                .architecture(a)
+                .configuration(task_conf().configuration())
+                .compiler_cache(true)
                 .preset(a == arch::x64 ? "vs2022-windows-x64" : "vs2022-windows-x86")
                 .arg("-DBUILD_TESTING=OFF"));
     }
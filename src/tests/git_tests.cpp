@@ -0,0 +1,119 @@
+#include "../tools/git_sparse.h"
+#include <gtest/gtest.h>
+
+// tests for the sparse-checkout check that decides whether a pull has to run
+// `git sparse-checkout set` again, built by the mob_tests target when
+// MOB_BUILD_TESTS is on
+//
+// the files are what git writes in .git after `git sparse-checkout set --cone`
+// or `git clone --sparse`; mob_assertion_failed() is in string_tests.cpp
+
+namespace {
+
+    using namespace mob;
+
+    const std::string worktree_extension = "[core]\n"
+                                           "\trepositoryformatversion = 1\n"
+                                           "[extensions]\n"
+                                           "\tworktreeConfig = true\n";
+
+    const std::string worktree_config = "[core]\n"
+                                        "\tsparseCheckout = true\n"
+                                        "\tsparseCheckoutCone = true\n";
+
+    const std::string cone_patterns = "/*\n"
+                                      "!/*/\n"
+                                      "/a/\n"
+                                      "!/a/*/\n"
+                                      "/a/b/\n"
+                                      "/c/\n";
+
+    const std::vector<std::string> dirs = {"a/b", "c"};
+
+}  // namespace
+
+// the first pull runs `set`, which writes the files above; the second pull
+// must find them unchanged
+//
+TEST(git_sparse, matches_after_set)
+{
+    EXPECT_TRUE(details::sparse_checkout_matches(worktree_extension,
+                                                 worktree_config, cone_patterns,
+                                                 dirs));
+}
+
+TEST(git_sparse, matches_normalized_dirs)
+{
+    EXPECT_TRUE(details::sparse_checkout_matches(worktree_extension,
+                                                 worktree_config, cone_patterns,
+                                                 {"a\\b\\", "/c"}));
+}
+
+// older versions of git don't use config.worktree
+//
+TEST(git_sparse, matches_in_config)
+{
+    const std::string config = "[core]\n"
+                               "\trepositoryformatversion = 0\n"
+                               "\tsparsecheckout = true\n";
+
+    EXPECT_TRUE(details::sparse_checkout_matches(config, "", cone_patterns, dirs));
+}
+
+TEST(git_sparse, config_is_case_insensitive)
+{
+    const std::string config = "[Core]\n"
+                               "\tSPARSECHECKOUT = Yes\n";
+
+    EXPECT_TRUE(details::sparse_checkout_matches(config, "", cone_patterns, dirs));
+}
+
+TEST(git_sparse, different_dirs)
+{
+    EXPECT_FALSE(details::sparse_checkout_matches(
+        worktree_extension, worktree_config, cone_patterns, {"a/b"}));
+
+    EXPECT_FALSE(details::sparse_checkout_matches(
+        worktree_extension, worktree_config, cone_patterns, {"a", "c"}));
+
+    EXPECT_FALSE(details::sparse_checkout_matches(
+        worktree_extension, worktree_config, cone_patterns, {"a/b", "c", "d"}));
+}
+
+// `git sparse-checkout disable` leaves the patterns
+//
+TEST(git_sparse, disabled)
+{
+    const std::string disabled = "[core]\n"
+                                 "\tsparseCheckout = false\n";
+
+    EXPECT_FALSE(details::sparse_checkout_matches(worktree_extension, disabled,
+                                                  cone_patterns, dirs));
+
+    // config.worktree overrides config
+    const std::string config = "[core]\n"
+                               "\tsparseCheckout = true\n";
+
+    EXPECT_FALSE(
+        details::sparse_checkout_matches(config, disabled, cone_patterns, dirs));
+}
+
+TEST(git_sparse, not_sparse)
+{
+    EXPECT_FALSE(details::sparse_checkout_matches(worktree_extension, "",
+                                                  cone_patterns, dirs));
+
+    EXPECT_FALSE(details::sparse_checkout_matches("", "", "", dirs));
+
+    // in another section
+    const std::string other = "[remote \"origin\"]\n"
+                              "\tsparseCheckout = true\n";
+
+    EXPECT_FALSE(details::sparse_checkout_matches(other, "", cone_patterns, dirs));
+}
+
+TEST(git_sparse, no_patterns)
+{
+    EXPECT_FALSE(details::sparse_checkout_matches(worktree_extension,
+                                                  worktree_config, "", dirs));
+}
@@ -0,0 +1,485 @@
+#include "../utility/string.h"
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// tests for the string utilities, built by the mob_tests target when
+// MOB_BUILD_TESTS is on
+//
+// find_newline() and utf16_to_utf8() have sse2 paths, so everything here is
+// compared against plain loops over the characters
+
+namespace mob {
+
+    // the tests don't use contexts, an assertion is just fatal
+    //
+    void mob_assertion_failed(const char* message, const char* exp, const wchar_t*,
+                              int line, const char* func)
+    {
+        std::cerr << "assertion failed: " << func << ":" << line << " "
+                  << (message ? message : "") << " (" << exp << ")\n";
+
+        std::abort();
+    }
+
+}  // namespace mob
+
+namespace {
+
+    using namespace mob;
+
+    template <class CharT>
+    bool is_newline(CharT c)
+    {
+        return (c == CharT('\n') || c == CharT('\r'));
+    }
+
+    template <class CharT>
+    const CharT* scalar_find_newline(const CharT* p, const CharT* end)
+    {
+        while (p != end && !is_newline(*p))
+            ++p;
+
+        return p;
+    }
+
+    // non-empty lines separated by any number of \r and \n, as ascii
+    //
+    template <class CharT>
+    std::vector<std::string> scalar_lines(std::basic_string_view<CharT> s)
+    {
+        std::vector<std::string> v;
+        std::string line;
+
+        for (CharT c : s) {
+            if (is_newline(c)) {
+                if (!line.empty())
+                    v.push_back(line);
+
+                line.clear();
+            }
+            else {
+                line += static_cast<char>(c);
+            }
+        }
+
+        if (!line.empty())
+            v.push_back(line);
+
+        return v;
+    }
+
+    // random string of `n` characters, about one in `one_in` is a newline
+    //
+    template <class CharT>
+    std::basic_string<CharT> random_string(std::mt19937& rng, std::size_t n,
+                                           unsigned int one_in = 6)
+    {
+        std::basic_string<CharT> s;
+
+        for (std::size_t i = 0; i < n; ++i) {
+            if (rng() % one_in == 0)
+                s += (rng() % 2 == 0 ? CharT('\n') : CharT('\r'));
+            else
+                s += CharT('a' + rng() % 26);
+        }
+
+        return s;
+    }
+
+    std::vector<std::string> lines_of(std::string_view s)
+    {
+        std::vector<std::string> v;
+
+        for_each_line(s, [&](std::string_view line) {
+            v.emplace_back(line);
+        });
+
+        return v;
+    }
+
+    // adds `bytes` to an encoded_buffer in random chunks, calling
+    // next_utf8_lines() after each one, and returns all the lines
+    //
+    std::vector<std::string> buffer_lines(std::mt19937& rng, encodings e,
+                                          std::string_view bytes)
+    {
+        encoded_buffer buffer(e);
+        std::vector<std::string> v;
+
+        const auto f = [&](std::string_view line) {
+            v.emplace_back(line);
+        };
+
+        std::size_t i = 0;
+
+        while (i < bytes.size()) {
+            const std::size_t n = 1 + rng() % 24;
+
+            buffer.add(bytes.substr(i, n));
+            buffer.next_utf8_lines(false, f);
+
+            i += n;
+        }
+
+        buffer.next_utf8_lines(true, f);
+
+        return v;
+    }
+
+    std::string to_bytes(std::wstring_view ws)
+    {
+        return std::string(reinterpret_cast<const char*>(ws.data()),
+                           ws.size() * sizeof(wchar_t));
+    }
+
+    // checks find_newline() on every suffix of `s`, which starts the search at
+    // every alignment
+    //
+    template <class CharT>
+    void check_find_newline(const std::basic_string<CharT>& s)
+    {
+        const CharT* const end = s.data() + s.size();
+
+        for (const CharT* p = s.data(); p <= end; ++p) {
+            ASSERT_EQ(find_newline(p, end), scalar_find_newline(p, end))
+                << "length " << s.size() << ", offset " << (p - s.data());
+        }
+    }
+
+    // utf8 for a utf16 string, one character at a time
+    //
+    std::string scalar_utf8(std::u16string_view s)
+    {
+        std::string r;
+
+        for (std::size_t i = 0; i < s.size(); ++i) {
+            char32_t c = s[i];
+
+            const bool high = (c >= 0xd800 && c <= 0xdbff);
+            const bool low_next =
+                (i + 1 < s.size() && s[i + 1] >= 0xdc00 && s[i + 1] <= 0xdfff);
+
+            if (high && low_next)
+                c = 0x10000 + ((c - 0xd800) << 10) + (s[++i] - 0xdc00);
+            else if (c >= 0xd800 && c <= 0xdfff)
+                c = 0xfffd;
+
+            if (c < 0x80) {
+                r += static_cast<char>(c);
+            }
+            else if (c < 0x800) {
+                r += static_cast<char>(0xc0 | (c >> 6));
+                r += static_cast<char>(0x80 | (c & 0x3f));
+            }
+            else if (c < 0x10000) {
+                r += static_cast<char>(0xe0 | (c >> 12));
+                r += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+                r += static_cast<char>(0x80 | (c & 0x3f));
+            }
+            else {
+                r += static_cast<char>(0xf0 | (c >> 18));
+                r += static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+                r += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+                r += static_cast<char>(0x80 | (c & 0x3f));
+            }
+        }
+
+        return r;
+    }
+
+    // converts with both utf16_to_utf8() overloads, wchar_t is only utf16 on
+    // windows
+    //
+    std::string to_utf8(std::u16string_view s)
+    {
+        std::string out;
+        const std::string r(out.data(), utf16_to_utf8(s, out));
+
+        if constexpr (sizeof(wchar_t) == 2) {
+            const std::wstring ws(s.begin(), s.end());
+            EXPECT_EQ(utf16_to_utf8(ws), r);
+        }
+
+        return r;
+    }
+
+    // ascii, two and three byte characters, surrogate pairs and unpaired
+    // surrogates
+    //
+    std::u16string random_utf16(std::mt19937& rng, std::size_t n)
+    {
+        std::u16string s;
+
+        for (std::size_t i = 0; i < n; ++i) {
+            switch (rng() % 8) {
+            case 0:
+                s += char16_t(0x80 + rng() % 0x780);
+                break;
+
+            case 1:
+                s += char16_t(0x800 + rng() % 0x7000);
+                break;
+
+            case 2:
+                s += char16_t(0xd800 + rng() % 0x400);
+                s += char16_t(0xdc00 + rng() % 0x400);
+                break;
+
+            case 3:
+                s += char16_t(0xd800 + rng() % 0x800);
+                break;
+
+            default:
+                s += char16_t(rng() % 0x80);
+                break;
+            }
+        }
+
+        return s;
+    }
+
+    // `prefix` characters, a run of `n` \r\n or \n\r, and a last line
+    //
+    std::string newline_run(std::size_t prefix, std::size_t n, bool crlf)
+    {
+        std::string s(prefix, 'x');
+
+        for (std::size_t i = 0; i < n; ++i)
+            s += (crlf ? "\r\n" : "\n\r");
+
+        return s + "last";
+    }
+
+}  // namespace
+
+TEST(find_newline, newline_at_every_position)
+{
+    for (std::size_t n = 0; n <= 40; ++n) {
+        check_find_newline(std::string(n, 'a'));
+        check_find_newline(std::wstring(n, L'a'));
+
+        for (std::size_t i = 0; i < n; ++i) {
+            for (char c : {'\n', '\r'}) {
+                std::string s(n, 'a');
+                s[i] = c;
+                check_find_newline(s);
+
+                std::wstring ws(n, L'a');
+                ws[i] = static_cast<wchar_t>(c);
+                check_find_newline(ws);
+            }
+        }
+    }
+}
+
+TEST(find_newline, random_strings)
+{
+    std::mt19937 rng(42);
+
+    for (std::size_t n = 0; n <= 40; ++n) {
+        for (int i = 0; i < 200; ++i) {
+            check_find_newline(random_string<char>(rng, n));
+            check_find_newline(random_string<wchar_t>(rng, n));
+        }
+    }
+}
+
+TEST(find_newline, ignores_bytes_of_wide_characters)
+{
+    // 0x0a0a and 0x0d0d have newline bytes, but aren't newlines
+    const std::wstring ws = {wchar_t(0x0a0a), wchar_t(0x0d0d), L'a', wchar_t(0x010a),
+                             wchar_t(0x0a01), L'\n'};
+
+    check_find_newline(ws);
+    EXPECT_EQ(find_newline(ws.data(), ws.data() + ws.size()), ws.data() + 5);
+}
+
+TEST(for_each_line, random_strings)
+{
+    std::mt19937 rng(42);
+
+    for (std::size_t n = 0; n <= 40; ++n) {
+        for (int i = 0; i < 200; ++i) {
+            const auto s = random_string<char>(rng, n);
+            EXPECT_EQ(lines_of(s), scalar_lines<char>(s)) << "'" << s << "'";
+        }
+    }
+}
+
+TEST(for_each_line, newline_runs_across_16_bytes)
+{
+    for (std::size_t prefix = 0; prefix <= 40; ++prefix) {
+        for (std::size_t n = 1; n <= 12; ++n) {
+            for (bool crlf : {true, false}) {
+                const auto s = newline_run(prefix, n, crlf);
+
+                std::vector<std::string> expected;
+                if (prefix > 0)
+                    expected.push_back(std::string(prefix, 'x'));
+                expected.push_back("last");
+
+                EXPECT_EQ(lines_of(s), expected) << "'" << s << "'";
+                EXPECT_EQ(lines_of(s), scalar_lines<char>(s)) << "'" << s << "'";
+            }
+        }
+    }
+}
+
+TEST(next_utf8_lines, random_strings)
+{
+    std::mt19937 rng(42);
+
+    for (std::size_t n = 0; n <= 40; ++n) {
+        for (int i = 0; i < 200; ++i) {
+            const auto s = random_string<char>(rng, n);
+            EXPECT_EQ(buffer_lines(rng, encodings::dont_know, s),
+                      scalar_lines<char>(s));
+
+            const auto ws = random_string<wchar_t>(rng, n);
+            EXPECT_EQ(buffer_lines(rng, encodings::utf16, to_bytes(ws)),
+                      scalar_lines<wchar_t>(ws));
+        }
+    }
+}
+
+TEST(next_utf8_lines, newline_runs_across_16_bytes)
+{
+    std::mt19937 rng(42);
+
+    for (std::size_t prefix = 0; prefix <= 40; ++prefix) {
+        for (std::size_t n = 1; n <= 12; ++n) {
+            for (bool crlf : {true, false}) {
+                const auto s = newline_run(prefix, n, crlf);
+                const std::wstring ws(s.begin(), s.end());
+
+                EXPECT_EQ(buffer_lines(rng, encodings::utf8, s),
+                          scalar_lines<char>(s));
+
+                EXPECT_EQ(buffer_lines(rng, encodings::utf16, to_bytes(ws)),
+                          scalar_lines<char>(s));
+            }
+        }
+    }
+}
+
+TEST(next_utf8_lines, wide_output_with_odd_byte_count)
+{
+    // the output stopped in the middle of a character, the stray byte is a
+    // newline byte but must not be taken as one
+    const auto bytes = to_bytes(L"first\r\nsecond\nthird") + '\n';
+
+    encoded_buffer buffer(encodings::utf16, bytes);
+    std::vector<std::string> v;
+
+    const auto f = [&](std::string_view line) {
+        v.emplace_back(line);
+    };
+
+    buffer.next_utf8_lines(false, f);
+    EXPECT_EQ(v, (std::vector<std::string>{"first", "second"}));
+
+    buffer.next_utf8_lines(true, f);
+    EXPECT_EQ(v, (std::vector<std::string>{"first", "second", "third"}));
+}
+
+TEST(next_utf8_lines, crlf_split_between_reads)
+{
+    encoded_buffer buffer(encodings::utf8);
+    std::vector<std::string> v;
+
+    const auto f = [&](std::string_view line) {
+        v.emplace_back(line);
+    };
+
+    buffer.add("first\r");
+    buffer.next_utf8_lines(false, f);
+
+    buffer.add("\nsecond");
+    buffer.next_utf8_lines(false, f);
+    EXPECT_EQ(v, (std::vector<std::string>{"first"}));
+
+    buffer.next_utf8_lines(true, f);
+    EXPECT_EQ(v, (std::vector<std::string>{"first", "second"}));
+}
+
+TEST(utf16_to_utf8, surrogates)
+{
+    // U+1F600, a pair
+    EXPECT_EQ(to_utf8(u"a\U0001f600b"), "a\xf0\x9f\x98\x80" "b");
+
+    // high surrogate at the end
+    EXPECT_EQ(to_utf8(u"abc\xd83d"), "abc\xef\xbf\xbd");
+
+    // low surrogate without a high one
+    EXPECT_EQ(to_utf8(u"\xde00" u"abc"), "\xef\xbf\xbd" "abc");
+
+    // high surrogate followed by ascii, the ascii is kept
+    EXPECT_EQ(to_utf8(u"\xd83d" u"abc"), "\xef\xbf\xbd" "abc");
+
+    // two high surrogates, then a low one: the second one is a pair
+    EXPECT_EQ(to_utf8(u"\xd83d\xd83d\xde00"), "\xef\xbf\xbd\xf0\x9f\x98\x80");
+}
+
+TEST(utf16_to_utf8, non_ascii_in_sse2_blocks)
+{
+    // the sse2 path copies 8 ascii characters at a time, put a non-ascii
+    // character, a pair or a lone surrogate at every position of strings that
+    // span a few blocks
+    const std::u16string others[] = {u"\u00e9", u"\u4e2d", u"\U0001f600", u"\xd83d",
+                                     u"\xde00"};
+
+    for (std::size_t n = 1; n <= 40; ++n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            for (auto&& o : others) {
+                std::u16string s(n, u'a');
+                s.replace(i, 1, o);
+
+                EXPECT_EQ(to_utf8(s), scalar_utf8(s)) << "length " << n << ", " << i;
+            }
+        }
+    }
+}
+
+TEST(utf16_to_utf8, random_strings)
+{
+    std::mt19937 rng(42);
+
+    for (std::size_t n = 0; n <= 40; ++n) {
+        for (int i = 0; i < 200; ++i) {
+            const auto s = random_utf16(rng, n);
+            EXPECT_EQ(to_utf8(s), scalar_utf8(s));
+        }
+    }
+}
+
+TEST(utf16_to_utf8, reused_buffer)
+{
+    std::string out;
+
+    // grown for the first line, only the returned length is valid after
+    const std::u16string first(100, u'\u00e9');
+    EXPECT_EQ(std::string(out.data(), utf16_to_utf8(first, out)), scalar_utf8(first));
+
+    const auto size = out.size();
+
+    EXPECT_EQ(std::string(out.data(), utf16_to_utf8(u"ab\u00e9", out)), "ab\xc3\xa9");
+    EXPECT_EQ(utf16_to_utf8(u"", out), 0u);
+
+    // not shrunk
+    EXPECT_EQ(out.size(), size);
+}
+
+TEST(next_utf8_lines, non_ascii_utf16)
+{
+    std::mt19937 rng(42);
+
+    const std::wstring ws = L"caf\u00e9\r\n\u4e2d\u6587\n\U0001f600 done";
+    const std::vector<std::string> expected = {
+        "caf\xc3\xa9", "\xe4\xb8\xad\xe6\x96\x87", "\xf0\x9f\x98\x80 done"};
+
+    for (int i = 0; i < 50; ++i)
+        EXPECT_EQ(buffer_lines(rng, encodings::utf16, to_bytes(ws)), expected);
+}
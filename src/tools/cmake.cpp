@@ -1,4 +1,6 @@
 #include "pch.h"
+#include "../core/diagnostics.h"
+#include "../core/metrics.h"
 #include "../core/process.h"
 #include "tools.h"
 
@@ -17,10 +19,42 @@ namespace mob {
             }
             gcx().bail_out(context::generic, "unknow configuration type {}", c);
         }
+
+        // written in the build directory after a successful generate, see
+        // cmake::configure_up_to_date()
+        //
+        constexpr auto configure_stamp = "mob-configure.json";
+
+        // file api directory in the build directory
+        //
+        fs::path file_api_path(const fs::path& build)
+        {
+            return build / ".cmake" / "api" / "v1";
+        }
+
+        // size, time and hash of a cmake input file, the hash is only checked
+        // when the size or time has changed
+        //
+        nlohmann::json make_input(const context& cx, const fs::path& f)
+        {
+            std::error_code size_ec, time_ec;
+
+            const auto size = fs::file_size(f, size_ec);
+            const auto time = fs::last_write_time(f, time_ec);
+            const auto hash = op::hash_file(cx, f);
+
+            if (size_ec || time_ec || !hash)
+                return nullptr;
+
+            return {{"size", size},
+                    {"time", time.time_since_epoch().count()},
+                    {"hash", *hash}};
+        }
     }  // namespace
 
     cmake::cmake(ops o)
-        : basic_process_runner("cmake"), op_(o), gen_(vs), arch_(arch::def)
+        : basic_process_runner("cmake"), op_(o), gen_(vs), jobs_(0),
+          compiler_cache_(false), arch_(arch::def)
     {
     }
 
@@ -29,6 +63,22 @@ namespace mob {
         return conf().tool().get("cmake");
     }
 
+    fs::path cmake::ninja_binary()
+    {
+        return conf().tool().get("ninja");
+    }
+
+    cmake::generators cmake::generator_from_name(std::string_view name)
+    {
+        if (name == "vs")
+            return vs;
+        else if (name == "ninja")
+            return ninja;
+
+        gcx().bail_out(context::generic,
+                       "bad cmake generator '{}', must be vs or ninja", name);
+    }
+
     cmake& cmake::generator(generators g)
     {
         gen_ = g;
@@ -120,6 +170,100 @@ namespace mob {
         return *this;
     }
 
+    cmake& cmake::jobs(int n)
+    {
+        jobs_ = n;
+        return *this;
+    }
+
+    cmake& cmake::compiler_cache(bool b)
+    {
+        compiler_cache_ = b;
+        return *this;
+    }
+
+    fs::path cmake::compiler_cache_path()
+    {
+        return conf().path().prefix() / "compiler-cache";
+    }
+
+    std::map<std::string, std::string> cmake::compiler_cache_vars()
+    {
+        // ccache and sccache have their own variable, setting both is harmless
+        const auto dir = path_to_utf8(compiler_cache_path());
+        return {{"CCACHE_DIR", dir}, {"SCCACHE_DIR", dir}};
+    }
+
+    env& cmake::compiler_cache_env(env& e)
+    {
+        for (auto&& [k, v] : compiler_cache_vars())
+            e.set(k, v);
+
+        return e;
+    }
+
+    void cmake::reset_compiler_cache_stats()
+    {
+        const auto launcher = conf().cmake().compiler_launcher();
+        if (launcher.empty())
+            return;
+
+        auto e = this_env::get();
+
+        process()
+            .binary(launcher)
+            .arg("--zero-stats")
+            .env(compiler_cache_env(e))
+            .stdout_level(context::level::trace)
+            .flags(process::allow_failure)
+            .run_and_join();
+    }
+
+    void cmake::log_compiler_cache_stats()
+    {
+        const auto launcher = conf().cmake().compiler_launcher();
+        if (launcher.empty())
+            return;
+
+        auto e = this_env::get();
+
+        auto p = process()
+                     .binary(launcher)
+                     .arg("--show-stats")
+                     .env(compiler_cache_env(e))
+                     .stdout_flags(process::keep_in_string)
+                     .flags(process::allow_failure);
+
+        if (p.run_and_join() != 0)
+            return;
+
+        gcx().info(context::generic, "compiler cache stats:");
+
+        for_each_line(p.stdout_string(), [&](auto&& line) {
+            gcx().info(context::generic, "  {}", line);
+        });
+    }
+
+    bool cmake::use_compiler_launcher() const
+    {
+        if (!compiler_cache_ || conf().cmake().compiler_launcher().empty())
+            return false;
+
+        if (gen_ != ninja) {
+            static std::once_flag warned;
+
+            std::call_once(warned, [&] {
+                cx().warning(context::generic,
+                             "[cmake] compiler_launcher is only supported with the "
+                             "ninja generator, ignoring it");
+            });
+
+            return false;
+        }
+
+        return true;
+    }
+
     cmake& cmake::cmd(const std::string& s)
     {
         cmd_ = s;
@@ -137,6 +281,20 @@ namespace mob {
         return root_ / (g.output_dir(arch_));
     }
 
+    fs::path cmake::binlog_base() const
+    {
+        // next to the build directory, like `vsbuild-INSTALL`
+        const auto dir = build_path();
+        auto name      = path_to_utf8(dir.filename()) + "-";
+
+        if (targets_.empty())
+            name += "build";
+        else
+            name += join(targets_, "-");
+
+        return dir.parent_path() / utf8_to_utf16(name);
+    }
+
     fs::path cmake::result() const
     {
         return build_path();
@@ -151,17 +309,44 @@ namespace mob {
         }
 
         case generate: {
-            do_generate();
+            auto p         = make_process();
+            const auto key = configure_key(p);
+
+            // the build files are regenerated by the build tool when cmake files
+            // change, but not when the command line or environment does; skipping
+            // it saves the few seconds it takes to check the compilers and find
+            // all the packages
+            if (configure_up_to_date(key)) {
+                cx().debug(context::generic, "configuration unchanged, skipping");
+                metrics::instance().add("cache.hits", "cmake_configure");
+                break;
+            }
+
+            metrics::instance().add("cache.misses", "cmake_configure");
+
+            // a failed generate must not leave an older stamp behind
+            op::delete_file(cx(), build_path() / configure_stamp, op::optional);
+
+            write_file_api_query();
+            execute_and_join(p);
+            write_configure_stamp(key);
+
             break;
         }
 
         case build: {
-            do_build();
+            auto p = make_process();
+            execute_and_join(p);
+
+            if (gen_ == vs)
+                msbuild::read_timings(cx(), binlog_base());
+
             break;
         }
 
         case install: {
-            do_install();
+            auto p = make_process();
+            execute_and_join(p);
             break;
         }
 
@@ -171,7 +356,244 @@ namespace mob {
         }
     }
 
-    void cmake::do_generate()
+    std::string cmake::script() const
+    {
+        const auto p = make_process();
+        std::string s;
+
+        // same as do_run()
+        if (op_ == generate) {
+            if (configure_up_to_date(configure_key(p))) {
+                cx().debug(context::generic, "configuration of {} unchanged, skipping",
+                           root_);
+
+                metrics::instance().add("cache.hits", "cmake_configure");
+                return s;
+            }
+
+            metrics::instance().add("cache.misses", "cmake_configure");
+
+            op::delete_file(cx(), build_path() / configure_stamp, op::optional);
+            write_file_api_query();
+        }
+
+        if (!p.cwd().empty()) {
+            const auto cwd = path_to_utf8(p.cwd());
+            s += "if not exist \"" + cwd + "\" mkdir \"" + cwd + "\"\r\n";
+            s += "cd /d \"" + cwd + "\"\r\n";
+        }
+
+        for (auto&& [k, v] : env_vars())
+            s += "set \"" + k + "=" + v + "\"\r\n";
+
+        s += p.command_line() + "\r\n";
+        s += "if errorlevel 1 exit /b 1\r\n";
+
+        return s;
+    }
+
+    void cmake::script_succeeded() const
+    {
+        // script() deletes the stamp when it configures
+        if (op_ != generate || fs::exists(build_path() / configure_stamp))
+            return;
+
+        write_configure_stamp(configure_key(make_process()));
+    }
+
+    std::string cmake::configure_key(const process& p) const
+    {
+        // the launcher and ninja are on the command line
+        std::string key = p.command_line() + "\n" + path_to_utf8(p.cwd()) + "\n";
+
+        for (auto&& [k, v] : env_vars())
+            key += k + "=" + v + "\n";
+
+        // compiler and sdk, the paths contain the versions
+        const auto vs = env::vs(arch_);
+
+        for (std::string k : {"VCToolsInstallDir", "WindowsSDKVersion"})
+            key += k + "=" + vs.get(k) + "\n";
+
+        // a different cmake might generate different files
+        std::error_code ec;
+        const auto t = fs::last_write_time(binary(), ec);
+        key += "cmake=" + std::to_string(ec ? 0 : t.time_since_epoch().count());
+
+        return key;
+    }
+
+    bool cmake::configure_up_to_date(const std::string& key) const
+    {
+        const auto stamp = build_path() / configure_stamp;
+
+        if (!fs::exists(build_path() / "CMakeCache.txt") || !fs::exists(stamp))
+            return false;
+
+        try {
+            const auto json = nlohmann::json::parse(
+                op::read_text_file(cx(), encodings::utf8, stamp, op::optional));
+
+            if (json.at("key").get<std::string>() != key) {
+                cx().debug(context::generic, "command line or environment changed");
+                return false;
+            }
+
+            for (auto&& [f, e] : json.at("inputs").items()) {
+                const fs::path path = utf8_to_utf16(f);
+                std::error_code size_ec, time_ec;
+
+                const auto size = fs::file_size(path, size_ec);
+                const auto time = fs::last_write_time(path, time_ec);
+
+                if (size_ec || time_ec) {
+                    cx().debug(context::generic, "{} is gone", f);
+                    return false;
+                }
+
+                if (size == e.at("size").get<std::uintmax_t>() &&
+                    time.time_since_epoch().count() ==
+                        e.at("time").get<fs::file_time_type::rep>()) {
+                    continue;
+                }
+
+                // same content with a new time, like after a checkout
+                const auto hash = op::hash_file(cx(), path);
+
+                if (!hash || *hash != e.at("hash").get<std::uint64_t>()) {
+                    cx().debug(context::generic, "{} has changed", f);
+                    return false;
+                }
+            }
+        }
+        catch (nlohmann::json::exception& e) {
+            cx().debug(context::generic, "bad configure stamp {}, {}", stamp, e.what());
+            return false;
+        }
+
+        return true;
+    }
+
+    void cmake::write_file_api_query() const
+    {
+        // an empty file is a stateless query, cmake writes the reply for it on
+        // every generate
+        const auto query = file_api_path(build_path()) / "query" / "cmakeFiles-v1";
+
+        op::create_directories(cx(), query.parent_path(), op::optional);
+        op::touch(cx(), query, op::optional);
+    }
+
+    void cmake::write_configure_stamp(const std::string& key) const
+    {
+        const auto stamp = build_path() / configure_stamp;
+        const auto reply = file_api_path(build_path()) / "reply";
+
+        // without a list of inputs, the stamp would miss changes to the cmake
+        // files, so none is written if anything goes wrong
+        try {
+            // index files have a timestamp in their name, the last one is the
+            // latest
+            fs::path index;
+            std::error_code ec;
+
+            if (fs::exists(reply)) {
+                for (auto&& e : fs::directory_iterator(reply, ec)) {
+                    const auto name = path_to_utf8(e.path().filename());
+
+                    if (name.starts_with("index-") && e.path() > index)
+                        index = e.path();
+                }
+            }
+
+            if (index.empty()) {
+                cx().debug(context::generic, "no file api reply in {}", reply);
+                return;
+            }
+
+            const auto index_json = nlohmann::json::parse(
+                op::read_text_file(cx(), encodings::utf8, index));
+
+            const auto files_json = nlohmann::json::parse(op::read_text_file(
+                cx(), encodings::utf8,
+                reply / index_json.at("reply")
+                            .at("cmakeFiles-v1")
+                            .at("jsonFile")
+                            .get<std::string>()));
+
+            const fs::path source =
+                utf8_to_utf16(files_json.at("paths").at("source").get<std::string>());
+
+            nlohmann::json inputs = nlohmann::json::object();
+
+            for (auto&& i : files_json.at("inputs")) {
+                // generated files are in the build directory and cmake's own
+                // modules come with the binary, which is in the key
+                if (i.value("isGenerated", false) || i.value("isCMake", false))
+                    continue;
+
+                // relative to the source directory unless external
+                const fs::path path = utf8_to_utf16(i.at("path").get<std::string>());
+                const auto f        = path.is_absolute() ? path : source / path;
+
+                auto e = make_input(cx(), f);
+                if (e.is_null()) {
+                    cx().debug(context::generic, "can't stat cmake input {}", f);
+                    return;
+                }
+
+                inputs[path_to_utf8(f)] = std::move(e);
+            }
+
+            const nlohmann::json json = {{"key", key}, {"inputs", inputs}};
+
+            op::write_text_file(cx(), encodings::utf8, stamp, json.dump(),
+                                op::optional);
+        }
+        catch (nlohmann::json::exception& e) {
+            cx().debug(context::generic, "bad file api reply in {}, {}", reply,
+                       e.what());
+        }
+    }
+
+    std::map<std::string, std::string> cmake::env_vars() const
+    {
+        std::map<std::string, std::string> vars;
+
+        if (op_ == generate) {
+            vars["CXXFLAGS"]   = "/wd4566";
+            vars["VCPKG_ROOT"] = absolute(conf().path().vcpkg()).string();
+
+            // the compilers are tested through the launcher
+            if (use_compiler_launcher())
+                vars.merge(compiler_cache_vars());
+        }
+        else if (op_ == build && gen_ == ninja) {
+            if (use_compiler_launcher())
+                vars.merge(compiler_cache_vars());
+        }
+
+        return vars;
+    }
+
+    process cmake::make_process() const
+    {
+        switch (op_) {
+        case generate:
+            return generate_process();
+
+        case build:
+            return build_process();
+
+        case install:
+            return install_process();
+
+        default:
+            cx().bail_out(context::generic, "no process for cmake op {}", op_);
+        }
+    }
+
+    process cmake::generate_process() const
     {
         if (root_.empty())
             cx().bail_out(context::generic, "cmake output path is empty");
@@ -181,6 +603,8 @@ namespace mob {
         auto p = process()
                      .stdout_encoding(encodings::utf8)
                      .stderr_encoding(encodings::utf8)
+                     .stdout_filter(diagnostics::filter(cx()))
+                     .stderr_filter(diagnostics::filter(cx()))
                      .binary(binary());
 
         if (!preset_.empty()) {
@@ -208,6 +632,27 @@ namespace mob {
 
         p.args(args_);
 
+        if (gen_ == ninja)
+            p.arg("-DCMAKE_MAKE_PROGRAM=", ninja_binary());
+
+        if (use_compiler_launcher()) {
+            const auto path = conf().cmake().compiler_launcher();
+
+            // msvc writes debug info for all the object files of a project into
+            // the same pdb with /Zi, which can't be cached; /Z7 puts it in the
+            // object files instead, and the pdb is still created by the linker
+            p.arg("-DCMAKE_C_COMPILER_LAUNCHER=", path, process::forward_slashes)
+                .arg("-DCMAKE_CXX_COMPILER_LAUNCHER=", path, process::forward_slashes)
+                .arg("-DCMAKE_POLICY_DEFAULT_CMP0141=NEW")
+                .arg("-DCMAKE_MSVC_DEBUG_INFORMATION_FORMAT=Embedded");
+        }
+
+        if (!preset_.empty() && gen_ == ninja) {
+            // presets are for visual studio, override the generator and put the
+            // build files somewhere else, a build directory can't switch generators
+            p.arg("-G", "\"" + g.name + "\"").arg("-B", build_path());
+        }
+
         if (preset_.empty()) {
 
             if (genstring_.empty()) {
@@ -230,19 +675,22 @@ namespace mob {
                 p.arg(cmd_);
         }
 
-        p.env(env::vs(arch_)
-                  .set("CXXFLAGS", "/wd4566")
-                  .set("VCPKG_ROOT", absolute(conf().path().vcpkg()).string()))
-            .cwd(preset_.empty() ? build_path() : root_);
+        auto e = env::vs(arch_);
+        for (auto&& [k, v] : env_vars())
+            e.set(k, v);
 
-        execute_and_join(p);
+        p.env(e).cwd(preset_.empty() ? build_path() : root_);
+
+        return p;
     }
 
-    void cmake::do_build()
+    process cmake::build_process() const
     {
         auto p = process()
                      .stdout_encoding(encodings::utf8)
                      .stderr_encoding(encodings::utf8)
+                     .stdout_filter(diagnostics::filter(cx()))
+                     .stderr_filter(diagnostics::filter(cx()))
                      .binary(binary())
                      .arg("--build")
                      .arg(build_path())
@@ -253,19 +701,38 @@ namespace mob {
             p = p.arg("--target").arg(target);
         }
 
-        execute_and_join(p);
+        if (jobs_ > 0)
+            p.arg("--parallel").arg(jobs_);
+
+        // anything after `--` is given to msbuild
+        if (gen_ == vs && conf().global().msbuild_binlog()) {
+            p.arg("--");
+            msbuild::add_binlog_args(p, binlog_base());
+        }
+
+        // ninja runs cl.exe directly and needs the vcvars environment for the
+        // architecture; visual studio finds its own toolchain, but custom commands
+        // inherit the environment, such as the scripts of the super build, which
+        // may run ninja themselves
+        auto e = env::vs(arch_);
+        for (auto&& [k, v] : env_vars())
+            e.set(k, v);
+
+        p.env(e);
+
+        return p;
     }
 
-    void cmake::do_install()
+    process cmake::install_process() const
     {
-        execute_and_join(process()
-                             .stdout_encoding(encodings::utf8)
-                             .stderr_encoding(encodings::utf8)
-                             .binary(binary())
-                             .arg("--install")
-                             .arg(build_path())
-                             .arg("--config")
-                             .arg(config_to_string(config_)));
+        return process()
+            .stdout_encoding(encodings::utf8)
+            .stderr_encoding(encodings::utf8)
+            .binary(binary())
+            .arg("--install")
+            .arg(build_path())
+            .arg("--config")
+            .arg(config_to_string(config_));
     }
 
     void cmake::do_clean()
@@ -280,9 +747,12 @@ namespace mob {
             // jom doesn't need -A for architectures
             {generators::jom, {"build", "NMake Makefiles JOM", "", ""}},
 
+            // ninja gets the architecture from the vcvars environment
+            {generators::ninja, {"ninjabuild", "Ninja Multi-Config", "", ""}},
+
             {generators::vs,
              {"vsbuild", "Visual Studio " + vs::version() + " " + vs::year(), "Win32",
-              "x64"}}};
+              "x64", true}}};
 
         return map;
     }
@@ -325,7 +795,7 @@ namespace mob {
 
     std::string cmake::gen_info::get_host(std::string_view conf_host) const
     {
-        if (conf_host.empty()) {
+        if (conf_host.empty() || !toolset) {
             return {};
         }
 
@@ -4,7 +4,7 @@ namespace mob {
 
     // a tool that runs `cmake ..` by default in a given directory
     //
-    // supports either visual studio or jom/nmake and x86/x64 architectures
+    // supports visual studio, jom/nmake or ninja and x86/x64 architectures
     //
     class cmake : public basic_process_runner {
     public:
@@ -12,6 +12,11 @@ namespace mob {
         //
         static fs::path binary();
 
+        // path to ninja, given to cmake as CMAKE_MAKE_PROGRAM for the ninja
+        // generator
+        //
+        static fs::path ninja_binary();
+
         // type of build files generated
         //
         enum class generators {
@@ -19,10 +24,32 @@ namespace mob {
             vs = 0x01,
 
             // generates build files for jom/nmake
-            jom = 0x02
+            jom = 0x02,
+
+            // generates build files for ninja, using the multi-config generator so
+            // configurations are handled the same way as visual studio; the
+            // compiler is the one from the vcvars environment for the architecture
+            ninja = 0x04
         };
         using enum generators;
 
+        // returns the generator for a `cmake_generator` value from the ini, either
+        // "vs" or "ninja"; bails out if it's anything else
+        //
+        static generators generator_from_name(std::string_view name);
+
+        // directory given to the compiler launcher for its cache, see
+        // compiler_cache()
+        //
+        static fs::path compiler_cache_path();
+
+        // runs the compiler launcher from [cmake] with `--zero-stats` or
+        // `--show-stats`, used by the build command before and after building;
+        // both do nothing if there's no launcher
+        //
+        static void reset_compiler_cache_stats();
+        static void log_compiler_cache_stats();
+
         // what run() will do
         //
         enum class ops {
@@ -42,7 +69,11 @@ namespace mob {
 
         cmake(ops o = generate);
 
-        // sets the generator, defaults to jom
+        // sets the generator, defaults to vs
+        //
+        // if a preset is also given, visual studio uses the generator from the
+        // preset, but ninja overrides it and uses its own build directory, see
+        // build_path()
         //
         cmake& generator(generators g);
 
@@ -72,6 +103,21 @@ namespace mob {
         // set the configuration types available when generating
         cmake& configuration_types(const std::vector<mob::config>& configs);
 
+        // maximum number of parallel jobs for build, passed as `--parallel`; 0
+        // lets the build tool decide, the default
+        //
+        cmake& jobs(int n);
+
+        // if true and [cmake] compiler_launcher is set, compiles through the
+        // launcher with its cache in compiler_cache_path(); pdbs are replaced by
+        // debug info embedded in object files, which is required for cache hits
+        // with msvc
+        //
+        // launchers only work with ninja, this is ignored with a warning for the
+        // other generators
+        //
+        cmake& compiler_cache(bool b);
+
         // overrides the directory in which cmake will write build files
         //
         // by default, this is a directory inside what was given in root() with a
@@ -123,6 +169,25 @@ namespace mob {
         //
         fs::path result() const;
 
+        // returns a batch script that does what run() would do for the generate,
+        // build or install ops: creates and changes to the working directory,
+        // sets the variables that would be added to the environment and runs
+        // cmake, exiting with 1 if it fails
+        //
+        // the vcvars environment is not part of the script, it has to be
+        // inherited from whatever runs it; used by the super_build task
+        //
+        // for generate, the script is empty if the configure stamp is up to
+        // date, like in run(); otherwise, the stamp is deleted and has to be
+        // written again by script_succeeded() once the script has run
+        //
+        std::string script() const;
+
+        // writes the configure stamp for generate if script() had to configure,
+        // does nothing for the other ops
+        //
+        void script_succeeded() const;
+
     protected:
         // calls either do_clean() or do_generate()
         //
@@ -152,6 +217,9 @@ namespace mob {
             //
             std::string get_arch(arch a) const;
 
+            // whether the generator supports -T, only visual studio does
+            bool toolset = false;
+
             // for generator that supports it, returns a toolset configuration to set
             // the host as specified in the configuration
             //
@@ -190,6 +258,12 @@ namespace mob {
         // configuration types
         std::vector<mob::config> config_types_;
 
+        // --parallel for build, 0 for none
+        int jobs_;
+
+        // see compiler_cache()
+        bool compiler_cache_;
+
         // passed verbatim
         std::vector<std::string> args_;
 
@@ -202,15 +276,63 @@ namespace mob {
         // overrides `..` on the command line
         std::string cmd_;
 
+        // whether compiler_cache() was set, there's a launcher in the ini and the
+        // generator supports it; warns once if the generator doesn't
+        //
+        bool use_compiler_launcher() const;
+
+        // variables for the cache directory of the compiler launcher
+        //
+        static std::map<std::string, std::string> compiler_cache_vars();
+
+        // sets compiler_cache_vars() in the environment
+        //
+        static env& compiler_cache_env(env& e);
+
+        // variables added on top of the vcvars environment for the current op
+        //
+        std::map<std::string, std::string> env_vars() const;
+
+        // everything the generate step depends on except for the cmake files:
+        // the command line, working directory, variables from env_vars() and the
+        // toolchain; stored in the configure stamp
+        //
+        std::string configure_key(const process& p) const;
+
+        // whether the build directory was generated with the same key and none
+        // of the cmake files reported by the file api has changed since, in which
+        // case generate is skipped; deleting the build directory, such as with
+        // --reconfigure, always runs it
+        //
+        bool configure_up_to_date(const std::string& key) const;
+
+        // asks cmake to report its input files through the file api
+        //
+        void write_file_api_query() const;
+
+        // writes the configure stamp with the given key and the input files from
+        // the file api reply
+        //
+        void write_configure_stamp(const std::string& key) const;
+
+        // base path for the msbuild binary log and performance summary of the
+        // build op, see msbuild::add_binlog_args()
+        //
+        fs::path binlog_base() const;
+
         // deletes the build directory
         //
         void do_clean();
 
-        // runs cmake
+        // returns the process for the current op, bails out for clean
+        //
+        process make_process() const;
+
+        // processes that run cmake for the generate, build and install ops
         //
-        void do_generate();
-        void do_build();
-        void do_install();
+        process generate_process() const;
+        process build_process() const;
+        process install_process() const;
 
         // returns a list of generators handled by this tool, same ones as in the
         // `generators` enum on top
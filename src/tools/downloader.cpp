@@ -1,9 +1,14 @@
 #include "pch.h"
+#include "../core/metrics.h"
+#include "../utility/threading.h"
 #include "tools.h"
 
 namespace mob {
 
-    downloader::downloader(ops o) : tool("dl"), op_(o) {}
+    downloader::downloader(ops o)
+        : tool("dl"), op_(o), extractor_(nullptr), extracted_(false)
+    {
+    }
 
     downloader::downloader(mob::url u, ops o) : downloader(o)
     {
@@ -22,11 +27,22 @@ namespace mob {
         return *this;
     }
 
+    downloader& downloader::extract_to(const fs::path& dir)
+    {
+        extract_to_ = dir;
+        return *this;
+    }
+
     fs::path downloader::result() const
     {
         return file_;
     }
 
+    bool downloader::extracted() const
+    {
+        return extracted_;
+    }
+
     void downloader::do_run()
     {
         switch (op_) {
@@ -48,14 +64,18 @@ namespace mob {
 
     void downloader::do_download()
     {
+        extracted_ = false;
         dl_.reset(new curl_downloader(&cx()));
 
         cx().trace(context::net, "looking for already downloaded files");
         if (use_existing()) {
             cx().trace(context::bypass, "using {}", file_);
+            metrics::instance().add("cache.hits", "download");
             return;
         }
 
+        metrics::instance().add("cache.misses", "download");
+
         cx().trace(context::net, "no cached downloads were found, will try:");
         for (auto&& u : urls_)
             cx().trace(context::net, "  . {}", u);
@@ -85,6 +105,10 @@ namespace mob {
 
         // downloading
         cx().trace(context::net, "trying {} into {}", u, file_);
+
+        if (can_stream())
+            return try_download_and_extract(u);
+
         dl_->start(u, file_);
 
         cx().trace(context::net, "waiting for download");
@@ -100,6 +124,79 @@ namespace mob {
         return false;
     }
 
+    bool downloader::can_stream() const
+    {
+        if (extract_to_.empty() || conf().global().dry())
+            return false;
+
+        // 7z and rar have their headers at the end or need to seek back, so they
+        // can only be extracted once the file is complete
+        static const std::vector<std::u8string> streamable = {
+            u8".zip", u8".tar", u8".tar.gz", u8".tgz", u8".tar.xz", u8".tar.bz2",
+            u8".tar.zst"};
+
+        const auto name = file_.filename().u8string();
+
+        for (auto&& ext : streamable) {
+            if (name.ends_with(ext))
+                return true;
+        }
+
+        cx().trace(context::net, "{} can't be extracted while downloading", file_);
+        return false;
+    }
+
+    bool downloader::try_download_and_extract(const mob::url& u)
+    {
+        cx().trace(context::net, "extracting into {} while downloading", extract_to_);
+
+        // filled by the curl thread, emptied by the extractor on this thread
+        byte_pipe pipe;
+
+        extractor ex;
+        ex.stream(&pipe).file(file_).output(extract_to_);
+
+        extractor_ = &ex;
+        guard g([&] {
+            extractor_ = nullptr;
+        });
+
+        dl_->tee(&pipe).start(u, file_);
+
+        // copy the context, the extractor will modify it
+        context cxcopy = cx();
+        std::exception_ptr error;
+
+        try {
+            ex.run(cxcopy);
+        }
+        catch (bailed&) {
+            error = std::current_exception();
+        }
+
+        // the extractor may stop before the end of the file, such as when
+        // the directory already exists, the rest only goes into the file
+        pipe.close_read();
+
+        cx().trace(context::net, "waiting for download");
+        dl_->join();
+        dl_->tee(nullptr);
+
+        if (error)
+            std::rethrow_exception(error);
+
+        if (dl_->ok()) {
+            // done; the extractor may have skipped an existing directory or
+            // failed to stream, the caller extracts the file in that case
+            cx().trace(context::net, "file {} downloaded", file_);
+            extracted_ = ex.extracted();
+            return true;
+        }
+
+        cx().debug(context::net, "download failed");
+        return false;
+    }
+
     void downloader::do_clean()
     {
         if (file_.empty()) {
@@ -122,6 +219,9 @@ namespace mob {
 
     void downloader::do_interrupt()
     {
+        if (extractor_)
+            extractor_->interrupt();
+
         if (dl_)
             dl_->interrupt();
     }
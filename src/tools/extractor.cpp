@@ -1,10 +1,14 @@
 #include "pch.h"
 #include "../core/process.h"
+#include "../utility/threading.h"
 #include "tools.h"
 
 namespace mob {
 
-    extractor::extractor() : basic_process_runner("extract") {}
+    extractor::extractor()
+        : basic_process_runner("extract"), pipe_(nullptr), extracted_(false)
+    {
+    }
 
     fs::path extractor::binary()
     {
@@ -23,12 +27,27 @@ namespace mob {
         return *this;
     }
 
+    extractor& extractor::stream(byte_pipe* p)
+    {
+        pipe_ = p;
+        return *this;
+    }
+
+    bool extractor::extracted() const
+    {
+        return extracted_;
+    }
+
     void extractor::do_run()
     {
+        extracted_ = false;
+
         interruption_file ifile(cx(), where_, "extractor");
 
         // check interruption file from last run
-        if (ifile.exists()) {
+        const bool resuming = ifile.exists();
+
+        if (resuming) {
             // resume the extraction, will overwrite
             cx().debug(context::generic,
                        "previous extraction was interrupted; resuming");
@@ -78,8 +97,424 @@ namespace mob {
         // just can't be used at all
         //
         // so the handling of a duplicate directory is done manually in
-        // check_duplicate_directory() below, unfortunately
+        // check_for_top_level_directory() after extraction, which only renames
+        // directories
+
+        if (pipe_) {
+            if (!extract_stream(ifile.file(), resuming)) {
+                // the output directory is deleted by delete_output, the
+                // downloaded file will be extracted normally
+                return;
+            }
+
+            // moves files up if necessary
+            if (!interrupted())
+                check_for_top_level_directory(ifile.file());
+        }
+        else if (!conf().global().dry() && extract_builtin(ifile.file(), resuming)) {
+            // moves files up if necessary
+            if (!interrupted())
+                check_for_top_level_directory(ifile.file());
+        }
+        else {
+            extract_7z();
+
+            // moves files up if necessary
+            check_for_top_level_directory(ifile.file());
+        }
+
+        // success or interruption, don't delete the directory
+        delete_output.cancel();
+
+        if (!interrupted()) {
+            // extraction finished and not interrupted, everything worked, so remove
+            // the interruption file
+            ifile.remove();
+            extracted_ = true;
+        }
+    }
+
+    void extractor::do_interrupt()
+    {
+        // unblocks the downloader if it's waiting for the pipe to be emptied
+        if (pipe_)
+            pipe_->close_read();
+
+        basic_process_runner::do_interrupt();
+    }
+
+    namespace {
+
+        struct archive_closer {
+            void operator()(archive* a)
+            {
+                if (a)
+                    archive_read_free(a);
+            }
+        };
+
+        using archive_ptr = std::unique_ptr<archive, archive_closer>;
+
+        // files larger than this are written by the reading thread directly
+        // instead of being buffered and handed to the thread pool
+        //
+        constexpr la_int64_t max_buffered_size = 64 * 1024 * 1024;
+
+        std::string archive_error(archive* a)
+        {
+            const char* s = archive_error_string(a);
+            return (s ? s : "unknown error");
+        }
+
+        // opens the given archive with all supported formats and filters, returns
+        // null on failure
+        //
+        archive_ptr open_archive(const context& cx, const fs::path& file)
+        {
+            archive_ptr a(archive_read_new());
+
+            archive_read_support_filter_all(a.get());
+            archive_read_support_format_all(a.get());
+
+            const auto r =
+                archive_read_open_filename_w(a.get(), file.native().c_str(), 64 * 1024);
+
+            if (r != ARCHIVE_OK) {
+                cx.debug(context::generic, "libarchive can't open {}, {}", file,
+                         archive_error(a.get()));
+
+                return {};
+            }
+
+            return a;
+        }
 
+        // state for read_pipe(), the buffer is handed to libarchive and must
+        // stay valid until the next read
+        //
+        struct pipe_source {
+            byte_pipe& pipe;
+            std::vector<char> buffer;
+        };
+
+        // libarchive read callback for archives that are being downloaded
+        //
+        la_ssize_t read_pipe(archive* a, void* data, const void** buffer)
+        {
+            auto& src    = *static_cast<pipe_source*>(data);
+            const auto n = src.pipe.read(src.buffer.data(), src.buffer.size());
+
+            if (n == 0 && !src.pipe.ok()) {
+                archive_set_error(a, EIO, "download failed or was interrupted");
+                return ARCHIVE_FATAL;
+            }
+
+            *buffer = src.buffer.data();
+            return static_cast<la_ssize_t>(n);
+        }
+
+        // path of the given entry relative to the output directory; returns an
+        // empty path if it's absolute or goes above the output directory
+        //
+        fs::path entry_path(archive_entry* e)
+        {
+            fs::path p;
+
+            if (const wchar_t* w = archive_entry_pathname_w(e))
+                p = w;
+            else if (const char* u = archive_entry_pathname_utf8(e))
+                p = utf8_to_utf16(u);
+            else
+                return {};
+
+            p = p.lexically_normal();
+
+            // directories end with a separator
+            if (!p.has_filename())
+                p = p.parent_path();
+
+            if (p.empty() || p.has_root_name() || p.has_root_directory())
+                return {};
+
+            for (auto&& c : p) {
+                if (c == L"..")
+                    return {};
+            }
+
+            return p;
+        }
+
+        // the entry's modification time as a file time, if any
+        //
+        std::optional<fs::file_time_type> entry_time(archive_entry* e)
+        {
+            if (!archive_entry_mtime_is_set(e))
+                return {};
+
+            return std::chrono::clock_cast<std::chrono::file_clock>(
+                std::chrono::system_clock::from_time_t(archive_entry_mtime(e)));
+        }
+
+        // whether `target` was already extracted by an interrupted run, which is
+        // the case if it has the right size and time, since the time is set
+        // last
+        //
+        bool already_extracted(const fs::path& target, la_int64_t size,
+                               const std::optional<fs::file_time_type>& time)
+        {
+            std::error_code ec;
+
+            if (size < 0 || !time)
+                return false;
+
+            if (fs::file_size(target, ec) != static_cast<std::uintmax_t>(size) || ec)
+                return false;
+
+            return (fs::last_write_time(target, ec) == *time && !ec);
+        }
+
+        // writes `size` bytes of `data` to `target`, sets the time if given
+        //
+        void write_entry(const context& cx, const fs::path& target, const char* data,
+                         std::size_t size,
+                         const std::optional<fs::file_time_type>& time)
+        {
+            {
+                std::ofstream out(target, std::ios::binary);
+                out.write(data, static_cast<std::streamsize>(size));
+                out.close();
+
+                if (!out)
+                    cx.bail_out(context::fs, "can't write to {}", target);
+            }
+
+            if (time) {
+                std::error_code ec;
+                fs::last_write_time(target, *time, ec);
+            }
+        }
+
+    }  // namespace
+
+    bool extractor::extract_builtin(const fs::path& ifile, bool resuming)
+    {
+        // a single pass, compressed tarballs are only decompressed once; the top
+        // level directory is moved afterwards, like for 7z
+        auto a = open_archive(cx(), file_);
+        if (!a)
+            return false;
+
+        cx().trace(context::generic, "extracting {} with libarchive", file_);
+
+        return extract_entries(a.get(), resuming, ifile);
+    }
+
+    bool extractor::extract_stream(const fs::path& ifile, bool resuming)
+    {
+        archive_ptr a(archive_read_new());
+
+        archive_read_support_filter_all(a.get());
+        archive_read_support_format_all(a.get());
+
+        pipe_source src{*pipe_, std::vector<char>(64 * 1024)};
+
+        if (archive_read_open(a.get(), &src, nullptr, read_pipe, nullptr) !=
+            ARCHIVE_OK) {
+            cx().debug(context::generic, "libarchive can't stream {}, {}", file_,
+                       archive_error(a.get()));
+
+            return false;
+        }
+
+        cx().trace(context::generic, "extracting {} with libarchive while downloading",
+                   file_);
+
+        return extract_entries(a.get(), resuming, ifile);
+    }
+
+    bool extractor::extract_entries(archive* a, bool resuming, const fs::path& ifile)
+    {
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        std::atomic<bool> failed = false;
+        int r                    = ARCHIVE_OK;
+
+        // set when the archive has a symbolic or hard link
+        bool has_links = false;
+
+        {
+            // joined at the end of the scope
+            thread_pool tp;
+
+            archive_entry* e = nullptr;
+            fs::path last_dir;
+
+            while ((r = archive_read_next_header(a, &e)) == ARCHIVE_OK) {
+                if (interrupted() || failed)
+                    break;
+
+                auto rel = entry_path(e);
+
+                if (rel.empty()) {
+                    const char* name = archive_entry_pathname(e);
+
+                    cx().warning(context::generic, "skipping unsafe entry '{}' in {}",
+                                 (name ? name : "?"), file_);
+
+                    continue;
+                }
+
+                const auto type = archive_entry_filetype(e);
+
+                // 7z creates links, which would need privileges or special
+                // handling here; hard links in tarballs are regular files with
+                // a link target and no data
+                if (type == AE_IFLNK || archive_entry_hardlink_w(e) ||
+                    archive_entry_hardlink(e)) {
+                    cx().debug(context::generic, "{} has link {}, using 7z", file_,
+                               rel);
+
+                    has_links = true;
+                    break;
+                }
+
+                const auto target = where_ / rel;
+
+                if (type == AE_IFDIR) {
+                    op::create_directories(cx(), target);
+                    continue;
+                }
+
+                if (type != AE_IFREG) {
+                    cx().warning(context::generic,
+                                 "skipping {} in {}, not a regular file", rel, file_);
+
+                    continue;
+                }
+
+                const auto size = (archive_entry_size_is_set(e) ? archive_entry_size(e)
+                                                                : la_int64_t(-1));
+
+                const auto time = entry_time(e);
+
+                if (resuming && already_extracted(target, size, time)) {
+                    cx().trace(context::generic, "{} already extracted", rel);
+                    continue;
+                }
+
+                if (target.parent_path() != last_dir) {
+                    last_dir = target.parent_path();
+                    op::create_directories(cx(), last_dir);
+                }
+
+                cx().trace(context::generic, "extracting {}", rel);
+
+                if (size >= 0 && size <= max_buffered_size) {
+                    // read on this thread, write in the pool
+                    auto data = std::make_shared<std::string>(
+                        static_cast<std::size_t>(size), '\0');
+
+                    la_ssize_t read = 0;
+
+                    while (read < size) {
+                        const auto n =
+                            archive_read_data(a, data->data() + read,
+                                              static_cast<std::size_t>(size - read));
+
+                        if (n <= 0)
+                            break;
+
+                        read += n;
+                    }
+
+                    if (read != size) {
+                        r = ARCHIVE_FATAL;
+                        break;
+                    }
+
+                    tp.add([&, target, data, time] {
+                        try {
+                            write_entry(cx(), target, data->data(), data->size(),
+                                        time);
+                        }
+                        catch (...) {
+                            // bailed, but also filesystem_error or bad_alloc;
+                            // this must not escape the thread
+                            std::scoped_lock lock(error_mutex);
+                            if (!error)
+                                error = std::current_exception();
+
+                            failed = true;
+                        }
+                    });
+                }
+                else {
+                    // too large or unknown size, stream it to disk here
+                    std::ofstream out(target, std::ios::binary);
+
+                    const void* block = nullptr;
+                    std::size_t n     = 0;
+                    la_int64_t offset = 0;
+                    int block_r       = ARCHIVE_OK;
+
+                    while ((block_r = archive_read_data_block(a, &block, &n,
+                                                              &offset)) ==
+                           ARCHIVE_OK) {
+                        out.seekp(static_cast<std::streamoff>(offset));
+                        out.write(static_cast<const char*>(block),
+                                  static_cast<std::streamsize>(n));
+                    }
+
+                    out.close();
+
+                    if (block_r != ARCHIVE_EOF) {
+                        r = block_r;
+                        break;
+                    }
+
+                    if (!out)
+                        cx().bail_out(context::fs, "can't write to {}", target);
+
+                    if (time) {
+                        std::error_code ec;
+                        fs::last_write_time(target, *time, ec);
+                    }
+                }
+            }
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+
+        if (interrupted())
+            return true;
+
+        if (has_links || r != ARCHIVE_EOF) {
+            if (!has_links) {
+                cx().debug(context::generic, "libarchive failed to extract {}, {}",
+                           file_, archive_error(a));
+            }
+
+            // remove everything except for the interruption file so 7z starts
+            // from scratch
+            for (auto&& e : fs::directory_iterator(where_)) {
+                if (e.path().filename() == ifile.filename())
+                    continue;
+
+                if (e.is_directory())
+                    op::delete_directory(cx(), e.path());
+                else
+                    op::delete_file(cx(), e.path());
+            }
+
+            return false;
+        }
+
+        return true;
+    }
+
+    void extractor::extract_7z()
+    {
         if (file_.u8string().ends_with(u8".tar.gz")) {
             // tar in gz, must be piped, 7z can't do it in one step
 
@@ -116,18 +551,6 @@ namespace mob {
                                  .arg("-o", where_, process::nospace)  // output file
                                  .arg(file_));                         // input file
         }
-
-        // moves files up if necessary
-        check_for_top_level_directory(ifile.file());
-
-        // success or interruption, don't delete the directory
-        delete_output.cancel();
-
-        if (!interrupted()) {
-            // extraction finished and not interrupted, everything worked, so remove
-            // the interruption file
-            ifile.remove();
-        }
     }
 
     void extractor::check_for_top_level_directory(const fs::path& ifile)
@@ -201,19 +624,61 @@ namespace mob {
         op::delete_directory(cx(), temp_dir);
     }
 
+    namespace {
+
+        // the profile's thread count unless `threads` is not 0
+        //
+        std::size_t archive_threads(const conf_archive& profile, std::size_t threads)
+        {
+            if (threads > 0)
+                return threads;
+
+            return static_cast<std::size_t>(std::max(0, profile.threads()));
+        }
+
+    }  // namespace
+
     void archiver::create_from_glob(const context& cx, const fs::path& out,
                                     const fs::path& glob,
-                                    const std::vector<std::string>& ignore)
+                                    const std::vector<std::string>& ignore,
+                                    const conf_archive& profile, std::size_t threads)
     {
         op::create_directories(cx, out.parent_path());
 
+        if (profile.format() == conf_archive::formats::tar_zst) {
+            // only handles globs like dir/* and names in `ignore`, which is all
+            // that's needed by the release command
+            const auto root = glob.parent_path();
+            std::vector<fs::path> files;
+
+            auto itor = fs::recursive_directory_iterator(root);
+
+            for (; itor != fs::recursive_directory_iterator(); ++itor) {
+                const auto name = path_to_utf8(itor->path().filename());
+
+                if (std::find(ignore.begin(), ignore.end(), name) != ignore.end()) {
+                    itor.disable_recursion_pending();
+                    continue;
+                }
+
+                if (itor->is_regular_file())
+                    files.push_back(fs::relative(itor->path(), root));
+            }
+
+            create_tar_zst(cx, out, root, files, profile,
+                           archive_threads(profile, threads));
+
+            return;
+        }
+
         auto p = process()
                      .binary(extractor::binary())
-                     .arg("a")      // add to archive
-                     .arg(out)      // output file
-                     .arg("-r")     // recursive
-                     .arg("-mx=5")  // normal compression level
-                     .arg(glob);    // input file
+                     .arg("a")    // add to archive
+                     .arg(out)    // output file
+                     .arg("-r")   // recursive
+                     .arg(glob);  // input file
+
+        add_7z_args(p, profile, archive_threads(profile, threads));
 
         for (auto&& i : ignore) {
             // x: exclude
@@ -228,13 +693,13 @@ namespace mob {
 
     void archiver::create_from_files(const context& cx, const fs::path& out,
                                      const std::vector<fs::path>& files,
-                                     const fs::path& files_root)
+                                     const fs::path& files_root,
+                                     const conf_archive& profile, std::size_t threads)
     {
-        std::string list_file_text;
+        std::vector<fs::path> relative_files;
         std::error_code ec;
 
-        // make each file relative to files_root, convert to utf8 and put in
-        // list_file_text separated by newlines
+        // make each file relative to files_root
         for (auto&& f : files) {
             fs::path rf = fs::relative(f, files_root, ec);
 
@@ -242,9 +707,24 @@ namespace mob {
                 cx.bail_out(context::fs, "file {} is not in root {}", f, files_root);
             }
 
-            list_file_text += path_to_utf8(rf) + "\n";
+            relative_files.push_back(std::move(rf));
         }
 
+        op::create_directories(cx, out.parent_path());
+
+        if (profile.format() == conf_archive::formats::tar_zst) {
+            create_tar_zst(cx, out, files_root, relative_files, profile,
+                           archive_threads(profile, threads));
+
+            return;
+        }
+
+        // convert to utf8 and put in list_file_text separated by newlines
+        std::string list_file_text;
+
+        for (auto&& rf : relative_files)
+            list_file_text += path_to_utf8(rf) + "\n";
+
         const auto list_file = make_temp_file();
 
         // always delete the list file when done
@@ -256,7 +736,6 @@ namespace mob {
         });
 
         op::write_text_file(gcx(), encodings::utf8, list_file, list_file_text);
-        op::create_directories(cx, out.parent_path());
 
         auto p = process()
                      .binary(extractor::binary())
@@ -265,8 +744,135 @@ namespace mob {
                      .arg("@", list_file, process::nospace)
                      .cwd(files_root);
 
+        add_7z_args(p, profile, archive_threads(profile, threads));
+
         p.run();
         p.join();
     }
 
+    void archiver::add_7z_args(process& p, const conf_archive& profile,
+                               std::size_t threads)
+    {
+        const bool zip = (profile.format() == conf_archive::formats::zip);
+
+        // archive type
+        p.arg(zip ? "-tzip" : "-t7z");
+
+        // compression level
+        p.arg("-mx=", profile.level(), process::nospace);
+
+        if (threads > 0)
+            p.arg("-mmt=", static_cast<int>(threads), process::nospace);
+
+        // solid blocks only exist in 7z
+        const auto solid = profile.solid_block();
+        if (!zip && !solid.empty())
+            p.arg("-ms=", solid, process::nospace);
+    }
+
+    void archiver::create_tar_zst(const context& cx, const fs::path& out,
+                                  const fs::path& root,
+                                  const std::vector<fs::path>& files,
+                                  const conf_archive& profile, std::size_t threads)
+    {
+        struct writer_closer {
+            void operator()(archive* a)
+            {
+                if (a)
+                    archive_write_free(a);
+            }
+        };
+
+        struct entry_closer {
+            void operator()(archive_entry* e)
+            {
+                if (e)
+                    archive_entry_free(e);
+            }
+        };
+
+        cx.trace(context::fs, "creating {} with libarchive, {} files", out,
+                 files.size());
+
+        std::unique_ptr<archive, writer_closer> a(archive_write_new());
+
+        archive_write_set_format_pax_restricted(a.get());
+        archive_write_add_filter_zstd(a.get());
+
+        auto set_option = [&](const char* name, const std::string& value) {
+            const auto r =
+                archive_write_set_filter_option(a.get(), "zstd", name, value.c_str());
+
+            if (r != ARCHIVE_OK) {
+                cx.warning(context::fs, "zstd doesn't support {}={}, {}", name, value,
+                           archive_error(a.get()));
+            }
+        };
+
+        set_option("compression-level", std::to_string(profile.level()));
+
+        if (threads > 0)
+            set_option("threads", std::to_string(threads));
+
+        const auto r = archive_write_open_filename_w(a.get(), out.native().c_str());
+
+        if (r != ARCHIVE_OK) {
+            cx.bail_out(context::fs, "can't create {}, {}", out,
+                        archive_error(a.get()));
+        }
+
+        std::vector<char> buffer(1024 * 1024);
+
+        for (auto&& rel : files) {
+            const auto p = root / rel;
+
+            std::error_code ec;
+            const auto size = fs::file_size(p, ec);
+            const auto time = fs::last_write_time(p, ec);
+
+            if (ec)
+                cx.bail_out(context::fs, "can't stat {}, {}", p, ec.message());
+
+            std::unique_ptr<archive_entry, entry_closer> e(archive_entry_new());
+
+            archive_entry_copy_pathname_w(e.get(), rel.generic_wstring().c_str());
+            archive_entry_set_filetype(e.get(), AE_IFREG);
+            archive_entry_set_perm(e.get(), 0644);
+            archive_entry_set_size(e.get(), static_cast<la_int64_t>(size));
+            archive_entry_set_mtime(
+                e.get(),
+                std::chrono::system_clock::to_time_t(
+                    std::chrono::clock_cast<std::chrono::system_clock>(time)),
+                0);
+
+            if (archive_write_header(a.get(), e.get()) != ARCHIVE_OK) {
+                cx.bail_out(context::fs, "can't add {} to {}, {}", rel, out,
+                            archive_error(a.get()));
+            }
+
+            std::ifstream in(p, std::ios::binary);
+            if (!in)
+                cx.bail_out(context::fs, "can't open {}", p);
+
+            while (in) {
+                in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+                const auto n = in.gcount();
+                if (n <= 0)
+                    break;
+
+                if (archive_write_data(a.get(), buffer.data(),
+                                       static_cast<std::size_t>(n)) < 0) {
+                    cx.bail_out(context::fs, "can't write {} to {}, {}", rel, out,
+                                archive_error(a.get()));
+                }
+            }
+        }
+
+        if (archive_write_close(a.get()) != ARCHIVE_OK) {
+            cx.bail_out(context::fs, "can't finish {}, {}", out,
+                        archive_error(a.get()));
+        }
+    }
+
 }  // namespace mob
@@ -2,28 +2,11 @@
 #include "../core/conf.h"
 #include "../core/process.h"
 #include "../utility/threading.h"
+#include "git_sparse.h"
 #include "tools.h"
 
 namespace mob::details {
 
-    // calls f() with each .ts file in the root, recursive
-    //
-    template <class F>
-    void for_each_ts(const fs::path& root, F&& f)
-    {
-        for (auto&& e : fs::recursive_directory_iterator(root)) {
-            if (!e.is_regular_file())
-                continue;
-
-            const auto p = e.path();
-
-            if (!path_to_utf8(p.extension()).ends_with(".ts"))
-                continue;
-
-            f(p);
-        }
-    }
-
     // returns a github url for the given org and git file
     //
     std::string make_url(const std::string& org, const std::string& git_file,
@@ -87,12 +70,15 @@ namespace mob::details {
             .cwd(root);
     }
 
-    [[nodiscard]] process revert(const fs::path& root, const fs::path& file)
+    [[nodiscard]] process revert(const fs::path& root, const std::string& files)
     {
+        // `files` is a list of nul-separated paths
         return make_process()
             .stderr_level(context::level::trace)
+            .stdin_string(files)
             .arg("checkout")
-            .arg(file)
+            .arg("--pathspec-from-file=-")
+            .arg("--pathspec-file-nul")
             .cwd(root);
     }
 
@@ -124,15 +110,32 @@ namespace mob::details {
     }
 
     [[nodiscard]] process clone(const fs::path& root, const mob::url& url,
-                                const std::string& branch, bool shallow)
+                                const std::string& branch,
+                                const git_wrap::clone_options& o)
     {
         auto p = make_process()
                      .stderr_level(context::level::trace)
                      .arg("clone")
                      .arg("--recurse-submodules");
 
-        if (shallow)
+        if (!o.reference.empty()) {
+            // objects are copied from the mirror, --dissociate makes sure the
+            // clone doesn't depend on the mirror once it's done
+            p.arg("--reference-if-able", o.reference).arg("--dissociate");
+        }
+        else if (o.shallow && o.filter.empty()) {
+            // a partial clone already avoids downloading most of the history,
+            // and --depth would make it incomplete
             p.arg("--depth", "1");
+        }
+
+        if (!o.filter.empty())
+            p.arg("--filter=", o.filter, process::nospace);
+
+        // only checks out the files at the root, set_sparse_checkout() adds the
+        // directories afterwards
+        if (!o.sparse.empty())
+            p.arg("--sparse");
 
         p.arg("--branch", branch)
             .arg("--quiet", process::log_quiet)
@@ -143,6 +146,43 @@ namespace mob::details {
         return p;
     }
 
+    [[nodiscard]] process set_sparse_checkout(const fs::path& root,
+                                              const std::vector<std::string>& dirs)
+    {
+        auto p = make_process()
+                     .stderr_level(context::level::trace)
+                     .arg("sparse-checkout")
+                     .arg("set")
+                     .arg("--cone");
+
+        for (auto&& d : dirs)
+            p.arg(d);
+
+        return std::move(p.cwd(root));
+    }
+
+    [[nodiscard]] process clone_mirror(const fs::path& root, const mob::url& url)
+    {
+        return make_process()
+            .stderr_level(context::level::trace)
+            .arg("clone")
+            .arg("--mirror")
+            .arg("--quiet", process::log_quiet)
+            .arg(url)
+            .arg(root);
+    }
+
+    [[nodiscard]] process fetch_mirror(const fs::path& root)
+    {
+        // a mirror's fetch refspec is +refs/*:refs/*, so this updates everything
+        return make_process()
+            .stderr_level(context::level::trace)
+            .arg("fetch")
+            .arg("--prune")
+            .arg("--quiet", process::log_quiet)
+            .cwd(root);
+    }
+
     [[nodiscard]] process pull(const fs::path& root, const mob::url& url,
                                const std::string& branch)
     {
@@ -192,24 +232,37 @@ namespace mob::details {
     }
 
     [[nodiscard]] process set_assume_unchanged(const fs::path& root,
-                                               const fs::path& file, bool on)
+                                               const std::string& files, bool on)
     {
+        // `files` is a list of nul-separated paths
         return make_process()
+            .stdin_string(files)
             .arg("update-index")
             .arg(on ? "--assume-unchanged" : "--no-assume-unchanged")
-            .arg(file, process::forward_slashes)
+            .arg("-z")
+            .arg("--stdin")
             .cwd(root);
     }
 
-    [[nodiscard]] process is_tracked(const fs::path& root, const fs::path& file)
+    [[nodiscard]] process ts_files(const fs::path& root)
     {
+        // with -z, paths are nul-separated and never quoted, which is also what
+        // update-index and checkout expect with -z and --pathspec-file-nul
         return make_process()
-            .stdout_level(context::level::debug)
-            .stderr_level(context::level::debug)
-            .flags(process::allow_failure)
+            .stdout_flags(process::keep_in_string)
+            .arg("ls-files")
+            .arg("-z")
+            .arg("--")
+            .arg("*.ts")
+            .cwd(root);
+    }
+
+    [[nodiscard]] process tracked_files(const fs::path& root)
+    {
+        return make_process()
+            .stdout_flags(process::keep_in_string)
             .arg("ls-files")
-            .arg("--error-unmatch")
-            .arg(file, process::forward_slashes)
+            .arg("-z")
             .cwd(root);
     }
 
@@ -249,6 +302,21 @@ namespace mob::details {
             .cwd(root);
     }
 
+    [[nodiscard]] process status(const fs::path& root)
+    {
+        return make_process()
+            .stdout_flags(process::keep_in_string)
+            .arg("status")
+            .arg("--porcelain=v2")
+            .arg("--branch")
+            .stderr_filter([](process::filter& f) {
+                if (f.line.find("not a git repo") != std::string::npos)
+                    f.lv = context::level::trace;
+            })
+            .flags(process::allow_failure)
+            .cwd(root);
+    }
+
     [[nodiscard]] process has_stashed_changes(const fs::path& root)
     {
         return make_process()
@@ -273,7 +341,12 @@ namespace mob::details {
 namespace mob {
 
     git_wrap::git_wrap(fs::path root, basic_process_runner* runner)
-        : root_(std::move(root)), runner_(runner)
+        : root_(std::move(root)), runner_(runner), cx_(nullptr)
+    {
+    }
+
+    git_wrap::git_wrap(fs::path root, const context& cx)
+        : root_(std::move(root)), runner_(nullptr), cx_(&cx)
     {
     }
 
@@ -284,31 +357,99 @@ namespace mob {
 
     int git_wrap::run(process&& p)
     {
-        if (runner_)
-            return runner_->execute_and_join(p);
-        else
-            return p.run_and_join();
+        return run(p);
     }
 
     int git_wrap::run(process& p)
     {
         if (runner_)
             return runner_->execute_and_join(p);
-        else
-            return p.run_and_join();
+
+        if (cx_)
+            p.set_context(cx_);
+
+        return p.run_and_join();
     }
 
     const context& git_wrap::cx()
     {
         if (runner_)
             return runner_->cx();
+        else if (cx_)
+            return *cx_;
         else
             return gcx();
     }
 
-    void git_wrap::clone(const mob::url& url, const std::string& branch, bool shallow)
+    void git_wrap::clone(const mob::url& url, const std::string& branch,
+                         const clone_options& o)
+    {
+        run(details::clone(root_, url, branch, o));
+
+        if (!o.sparse.empty())
+            set_sparse_checkout(o.sparse);
+    }
+
+    void git_wrap::set_sparse_checkout(const std::vector<std::string>& dirs)
+    {
+        run(details::set_sparse_checkout(root_, dirs));
+    }
+
+    bool git_wrap::has_sparse_checkout(const std::vector<std::string>& dirs)
     {
-        run(details::clone(root_, url, branch, shallow));
+        const auto dir = git_dir();
+        if (dir.empty())
+            return false;
+
+        // missing files are empty
+        const auto read = [&](const fs::path& p) {
+            std::error_code ec;
+            if (!fs::exists(p, ec))
+                return std::string();
+
+            return op::read_text_file(cx(), encodings::utf8, p, op::optional);
+        };
+
+        return details::sparse_checkout_matches(
+            read(dir / "config"), read(dir / "config.worktree"),
+            read(dir / "info" / "sparse-checkout"), dirs);
+    }
+
+    fs::path git_wrap::mirror_path(const mob::url& url)
+    {
+        std::string name = url.string();
+
+        // strip the scheme, if any
+        if (const auto pos = name.find("://"); pos != std::string::npos)
+            name = name.substr(pos + 3);
+
+        for (auto& c : name) {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '-')
+                c = '_';
+        }
+
+        if (!name.ends_with(".git"))
+            name += ".git";
+
+        return conf().path().cache() / "git-mirrors" / name;
+    }
+
+    void git_wrap::update_mirror(const mob::url& url)
+    {
+        if (fs::exists(root_ / "HEAD")) {
+            cx().debug(context::generic, "updating mirror {}", root_);
+            run(details::fetch_mirror(root_));
+        }
+        else {
+            cx().debug(context::generic, "creating mirror {} for {}", root_, url);
+
+            // a previous clone might have been interrupted
+            if (fs::exists(root_))
+                op::delete_directory(cx(), root_);
+
+            op::create_directories(cx(), root_.parent_path());
+            run(details::clone_mirror(root_, url));
+        }
     }
 
     void git_wrap::pull(const mob::url& url, const std::string& branch)
@@ -362,46 +503,79 @@ namespace mob {
         run(details::set_remote_push(root_, remote, url));
     }
 
-    void git_wrap::set_assume_unchanged(const fs::path& file, bool on)
+    void git_wrap::ignore_ts(bool b)
     {
-        run(details::set_assume_unchanged(root_, file, on));
+        const auto files = ts_files();
+        if (files.empty()) {
+            cx().trace(context::generic, "no tracked .ts files in {}", root_);
+            return;
+        }
+
+        run(details::set_assume_unchanged(root_, files, b));
     }
 
-    void git_wrap::ignore_ts(bool b)
+    void git_wrap::revert_ts()
     {
-        details::for_each_ts(root_, [&](auto&& p) {
-            const auto rp = fs::relative(p, root_);
+        const auto files = ts_files();
+        if (files.empty()) {
+            cx().trace(context::generic, "no tracked .ts files in {}", root_);
+            return;
+        }
 
-            if (is_tracked(rp)) {
-                cx().trace(context::generic, "  . {}", rp);
-                set_assume_unchanged(rp, b);
-            }
-            else {
-                cx().trace(context::generic, "  . {} (skipping, not tracked)", rp);
-            }
-        });
+        run(details::revert(root_, files));
     }
 
-    void git_wrap::revert_ts()
+    std::string git_wrap::ts_files()
     {
-        details::for_each_ts(root_, [&](auto&& p) {
-            const auto rp = fs::relative(p, root_);
+        auto p = details::ts_files(root_);
+        run(p);
 
-            if (is_tracked(rp)) {
-                run(details::revert(root_, p));
-            }
-            else {
-                cx().debug(context::generic,
-                           "won't try to revert ts file '{}', not tracked", rp);
+        std::string files = p.stdout_string();
 
-                return;
+        if (context::enabled(context::level::trace)) {
+            std::size_t start = 0;
+
+            while (start < files.size()) {
+                auto end = files.find('\0', start);
+                if (end == std::string::npos)
+                    end = files.size();
+
+                cx().trace(context::generic, "  . {}",
+                           std::string_view(files).substr(start, end - start));
+
+                start = end + 1;
             }
-        });
+        }
+
+        return files;
     }
 
-    bool git_wrap::is_tracked(const fs::path& file)
+    std::vector<fs::path> git_wrap::tracked_files()
     {
-        return (run(details::is_tracked(root_, file)) == 0);
+        auto p = details::tracked_files(root_);
+        run(p);
+
+        const std::string out = p.stdout_string();
+        std::vector<fs::path> files;
+        std::size_t start = 0;
+
+        // nul-separated, never quoted
+        while (start < out.size()) {
+            auto end = out.find('\0', start);
+            if (end == std::string::npos)
+                end = out.size();
+
+            if (end > start) {
+                files.emplace_back(
+                    utf8_to_utf16(std::string_view(out).substr(start, end - start)));
+            }
+
+            start = end + 1;
+        }
+
+        cx().trace(context::generic, "{} tracked files in {}", files.size(), root_);
+
+        return files;
     }
 
     bool git_wrap::has_remote(const std::string& name)
@@ -501,19 +675,21 @@ namespace mob {
         //
         // so check first to avoid outputting git errors because it doesn't know
         // about the directory
-        if (g.is_git_repo()) {
+        const auto st = g.status();
+
+        if (st.repo) {
             // make sure there are no uncommitted or stashed changes to avoid losing
             // data
 
             if (!conf().global().get<bool>("ignore_uncommitted")) {
-                if (g.has_uncommitted_changes()) {
+                if (st.dirty) {
                     cx.bail_out(context::redownload,
                                 "will not delete {}, has uncommitted changes; "
                                 "see --ignore-uncommitted-changes",
                                 dir);
                 }
 
-                if (g.has_stashed_changes()) {
+                if (st.stashed) {
                     cx.bail_out(context::redownload,
                                 "will not delete {}, has stashed changes; "
                                 "see --ignore-uncommitted-changes",
@@ -528,6 +704,122 @@ namespace mob {
         op::delete_directory(cx, dir, op::optional);
     }
 
+    git_wrap::repo_status git_wrap::status()
+    {
+        repo_status st;
+
+        auto p = details::status(root_);
+        if (run(p) != 0)
+            return st;
+
+        st.repo = true;
+
+        // headers start with `#`, everything else is a changed or untracked file;
+        // ignored files are not listed without --ignored
+        for_each_line(p.stdout_string(), [&](std::string_view line) {
+            if (!line.starts_with("# ")) {
+                st.dirty = true;
+                return;
+            }
+
+            line.remove_prefix(2);
+
+            const auto sp = line.find(' ');
+            if (sp == std::string_view::npos)
+                return;
+
+            const auto key   = line.substr(0, sp);
+            const auto value = line.substr(sp + 1);
+
+            if (key == "branch.head") {
+                if (value != "(detached)")
+                    st.branch = std::string(value);
+            }
+            else if (key == "branch.upstream") {
+                st.upstream = std::string(value);
+            }
+            else if (key == "branch.ab") {
+                // `+ahead -behind`
+                const auto minus = value.find(" -");
+
+                if (value.starts_with('+') && minus != std::string_view::npos) {
+                    const char* b = value.data();
+                    std::from_chars(b + 1, b + minus, st.ahead);
+                    std::from_chars(b + minus + 2, b + value.size(), st.behind);
+                }
+            }
+        });
+
+        if (auto s = has_stash_ref())
+            st.stashed = *s;
+        else
+            st.stashed = has_stashed_changes();
+
+        return st;
+    }
+
+    fs::path git_wrap::git_dir()
+    {
+        fs::path dir = root_ / ".git";
+
+        // submodules and worktrees have a .git file with `gitdir: path`
+        if (fs::is_regular_file(dir)) {
+            const auto s =
+                op::read_text_file(cx(), encodings::dont_know, dir, op::optional);
+
+            if (!s.starts_with("gitdir: "))
+                return {};
+
+            dir = fs::path(utf8_to_utf16(trim_copy(s.substr(8))));
+            if (dir.is_relative())
+                dir = root_ / dir;
+        }
+
+        if (!fs::is_directory(dir))
+            return {};
+
+        return dir;
+    }
+
+    std::optional<bool> git_wrap::has_stash_ref()
+    {
+        fs::path dir = git_dir();
+        if (dir.empty())
+            return {};
+
+        // worktrees share refs with the main repo
+        if (fs::exists(dir / "commondir")) {
+            const auto s = op::read_text_file(cx(), encodings::dont_know,
+                                              dir / "commondir", op::optional);
+
+            fs::path common = utf8_to_utf16(trim_copy(s));
+            dir             = (common.is_relative() ? dir / common : common);
+        }
+
+        // refs are not files with the reftable backend
+        if (fs::exists(dir / "reftable"))
+            return {};
+
+        if (fs::exists(dir / "refs" / "stash"))
+            return true;
+
+        const auto packed = dir / "packed-refs";
+        if (!fs::exists(packed))
+            return false;
+
+        bool found = false;
+
+        const auto s =
+            op::read_text_file(cx(), encodings::dont_know, packed, op::optional);
+
+        for_each_line(s, [&](std::string_view line) {
+            if (line.ends_with(" refs/stash"))
+                found = true;
+        });
+
+        return found;
+    }
+
     bool git_wrap::is_git_repo()
     {
         return (run(details::is_repo(root_)) == 0);
@@ -538,6 +830,32 @@ namespace mob {
         return (details::remote_branch_exists(u, name).run_and_join() == 0);
     }
 
+    git_wrap::branch_status
+    git_wrap::check_remote_branch(const mob::url& u, const std::string& name,
+                                  std::chrono::milliseconds timeout, std::string* error)
+    {
+        // ls-remote --exit-code returns 2 when no refs match
+        const int missing = 2;
+
+        auto p = details::remote_branch_exists(u, name);
+        p.stderr_flags(process::keep_in_string).timeout(timeout);
+
+        const int r = p.run_and_join();
+
+        if (r == 0)
+            return branch_status::found;
+        else if (r == missing)
+            return branch_status::missing;
+
+        if (error)
+            *error = trim_copy(p.stderr_string());
+
+        if (p.timed_out())
+            return branch_status::timed_out;
+
+        return branch_status::failed;
+    }
+
     bool git_wrap::has_uncommitted_changes()
     {
         auto p = details::has_uncommitted_changes(root_);
@@ -553,7 +871,8 @@ namespace mob {
 
     git::git(ops o)
         : basic_process_runner("git"), op_(o), ignore_ts_(false), revert_ts_(false),
-          shallow_(false), no_push_upstream_(false), push_default_origin_(false)
+          shallow_(false), mirror_(false), no_push_upstream_(false),
+          push_default_origin_(false)
     {
     }
 
@@ -600,6 +919,24 @@ namespace mob {
         return *this;
     }
 
+    git& git::filter(const std::string& spec)
+    {
+        filter_ = spec;
+        return *this;
+    }
+
+    git& git::sparse(const std::vector<std::string>& dirs)
+    {
+        sparse_ = dirs;
+        return *this;
+    }
+
+    git& git::mirror(bool b)
+    {
+        mirror_ = b;
+        return *this;
+    }
+
     git& git::remote(std::string org, std::string key, bool no_push_upstream,
                      bool push_default_origin)
     {
@@ -648,9 +985,21 @@ namespace mob {
             return false;
         }
 
+        git_wrap::clone_options o;
+        o.shallow = shallow_;
+        o.filter  = filter_;
+        o.sparse  = sparse_;
+
+        if (mirror_ && !conf().global().dry()) {
+            // one fetch into the local mirror, the clone then only needs to
+            // negotiate refs with the remote
+            o.reference = git_wrap::mirror_path(url_);
+            git_wrap(o.reference, this).update_mirror(url_);
+        }
+
         git_wrap g(root_, this);
 
-        g.clone(url_, branch_, shallow_);
+        g.clone(url_, branch_, o);
 
         if (!creds_username_.empty() || !creds_email_.empty())
             g.set_credentials(creds_username_, creds_email_);
@@ -673,6 +1022,12 @@ namespace mob {
         if (revert_ts_)
             g.revert_ts();
 
+        // in case the directories have changed in the ini; the check reads the
+        // files in .git instead of spawning git, so unchanged repos don't pay for
+        // an extra process
+        if (!sparse_.empty() && !g.has_sparse_checkout(sparse_))
+            g.set_sparse_checkout(sparse_);
+
         g.pull(url_, branch_);
     }
 
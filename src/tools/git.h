@@ -24,10 +24,57 @@ namespace mob {
         //
         git_wrap(fs::path root, basic_process_runner* runner = nullptr);
 
-        // runs `git clone` with the url and branch, adds `--depth 1` when `shallow`
-        // is true
+        // runs git commands in the given root directory and logs to the given
+        // context instead of gcx(), including the output of the processes
         //
-        void clone(const mob::url& url, const std::string& branch, bool shallow);
+        git_wrap(fs::path root, const context& cx);
+
+        // options for clone()
+        //
+        struct clone_options {
+            // adds `--depth 1`
+            bool shallow = false;
+
+            // a local mirror from update_mirror() given to --reference-if-able,
+            // so objects are copied locally instead of being downloaded;
+            // `shallow` is ignored when this is set
+            fs::path reference;
+
+            // given to --filter for a partial clone, such as "blob:none" or
+            // "tree:0"; missing objects are fetched on demand later; `shallow`
+            // is ignored when this is set so the history is complete
+            std::string filter;
+
+            // directories for a cone mode sparse-checkout, empty for a full
+            // checkout
+            std::vector<std::string> sparse;
+        };
+
+        // runs `git clone` with the url and branch, see clone_options
+        //
+        void clone(const mob::url& url, const std::string& branch,
+                   const clone_options& o);
+
+        // runs `git sparse-checkout set --cone` with the given directories
+        //
+        void set_sparse_checkout(const std::vector<std::string>& dirs);
+
+        // whether the repo already has a cone mode sparse-checkout of exactly the
+        // given directories; reads the config files and patterns in .git
+        // directly instead of running git, see details::sparse_checkout_matches(),
+        // returns false if they can't be read
+        //
+        bool has_sparse_checkout(const std::vector<std::string>& dirs);
+
+        // path of the bare mirror for the given url, in $cache/git-mirrors
+        //
+        static fs::path mirror_path(const mob::url& url);
+
+        // the root is a mirror from mirror_path(): creates it with
+        // `git clone --mirror` if it doesn't exist, or updates it with a single
+        // `git fetch` otherwise
+        //
+        void update_mirror(const mob::url& url);
 
         // runs `git pull` with the given url and branch
         //
@@ -55,8 +102,9 @@ namespace mob {
                                              bool no_push_upstream,
                                              bool push_default_origin);
 
-        // finds all the .ts files in the root (recursive) and either sets or
-        // removes the --assume-unchanged flag on all of them
+        // finds all the tracked .ts files in the root (recursive) and either sets
+        // or removes the --assume-unchanged flag on all of them; this runs one
+        // `git ls-files` and one `git update-index` for the whole repo
         //
         // .ts files are translation files that are automatically generated by Qt
         // when building the various projects and they can change at any time;
@@ -68,17 +116,18 @@ namespace mob {
         //
         void ignore_ts(bool b);
 
-        // finds all the .ts files in the root (recursive) and reverts them (does
-        // a `git checkout` on all of them)
+        // finds all the tracked .ts files in the root (recursive) and reverts them
+        // with a single `git checkout`
         //
         // this is used when pulling changes to revert all the .ts before pulling
         // so there are no conflicts
         //
         void revert_ts();
 
-        // returns whether the given file is known to git
+        // returns every file in the index, relative to the root; this is a single
+        // `git ls-files`, so it doesn't touch the working tree at all
         //
-        bool is_tracked(const fs::path& file);
+        std::vector<fs::path> tracked_files();
 
         // returns whether the given remote name exists
         //
@@ -125,10 +174,6 @@ namespace mob {
         //
         void set_config(const std::string& key, const std::string& value);
 
-        // sets --assume-unchanged or --no-assume-unchanged for the given file
-        //
-        void set_assume_unchanged(const fs::path& relative_file, bool on);
-
         // returns the .git file used by the origin remote, such as modorganizer.git
         //
         std::string git_file();
@@ -174,6 +219,41 @@ namespace mob {
         //
         bool has_stashed_changes();
 
+        // state of a repo, see status()
+        //
+        struct repo_status {
+            // false if the directory is not a git repo, everything else is then
+            // left to defaults
+            bool repo = false;
+
+            // name of the active branch, empty on a detached head
+            std::string branch;
+
+            // upstream of the branch, such as `origin/master`, empty if none
+            std::string upstream;
+
+            // commits ahead and behind the upstream, 0 without an upstream
+            int ahead  = 0;
+            int behind = 0;
+
+            // whether there are modified, staged or untracked files
+            bool dirty = false;
+
+            // whether there are stashed changes
+            bool stashed = false;
+        };
+
+        // gets the state of the repo with a single `git status --porcelain=v2
+        // --branch`; stashes are checked by looking for refs/stash in the .git
+        // directory instead of spawning another git process
+        //
+        // this replaces is_git_repo(), current_branch(), has_uncommitted_changes()
+        // and has_stashed_changes() when more than one of them is needed; it
+        // doesn't log errors for directories that aren't repos and can be called
+        // for multiple repos from multiple threads
+        //
+        repo_status status();
+
         // used by various tasks to delete a directory that was created by pulling
         // from git
         //
@@ -192,13 +272,41 @@ namespace mob {
         //
         static bool remote_branch_exists(const mob::url& u, const std::string& name);
 
+        // result of check_remote_branch()
+        //
+        enum class branch_status { found, missing, failed, timed_out };
+
+        // same as remote_branch_exists(), but gives up after `timeout` and tells
+        // apart a missing branch from a failure; if `error` is not null, it
+        // receives stderr from git when the check failed
+        //
+        // this doesn't log errors and can be called from multiple threads
+        //
+        static branch_status check_remote_branch(const mob::url& u,
+                                                 const std::string& name,
+                                                 std::chrono::milliseconds timeout,
+                                                 std::string* error = nullptr);
+
     private:
+        // whether refs/stash exists in the .git directory, or nullopt if it
+        // can't be determined without git, such as for the reftable backend
+        //
+        std::optional<bool> has_stash_ref();
+
+        // the .git directory, or the one given by the .git file of submodules and
+        // worktrees; empty if it can't be found
+        //
+        fs::path git_dir();
+
         // git root directory, from constructor
         fs::path root_;
 
         // optional tool that's running these git commands
         basic_process_runner* runner_;
 
+        // optional log context, ignored if runner_ is not null
+        const context* cx_;
+
         // either runs the given process directly or asks runner_ to run it if it's
         // not null
         //
@@ -208,9 +316,15 @@ namespace mob {
         int run(process&& p);
         int run(process& p);
 
-        // log context, either gcx() or the one from runner_ if it's not null
+        // log context, either the one from runner_ if it's not null, the one given
+        // in the constructor or gcx()
         //
         const context& cx();
+
+        // returns all the .ts files known to git, as nul-separated paths relative
+        // to the root
+        //
+        std::string ts_files();
     };
 
     // tool to handle git operations, used by tasks
@@ -256,10 +370,25 @@ namespace mob {
         //
         git& credentials(const std::string& username, const std::string& email);
 
-        // if true, clones with `--depth 1`
+        // if true, clones with `--depth 1`, ignored when filter() is set
         //
         git& shallow(bool b);
 
+        // if not empty, makes a partial clone with `--filter`, such as "blob:none";
+        // the clone has the whole history, shallow() is ignored
+        //
+        git& filter(const std::string& spec);
+
+        // if not empty, only checks out these directories with a cone mode
+        // sparse-checkout; also applied before pulling an existing repo
+        //
+        git& sparse(const std::vector<std::string>& dirs);
+
+        // if true, clones through a local mirror of the url in the cache, see
+        // git_wrap::update_mirror()
+        //
+        git& mirror(bool b);
+
         // if set, calls git_wrap::set_origin_and_upstream_remotes()
         //
         git& remote(std::string org, std::string key, bool no_push_upstream,
@@ -281,6 +410,9 @@ namespace mob {
         std::string creds_username_;
         std::string creds_email_;
         bool shallow_;
+        std::string filter_;
+        std::vector<std::string> sparse_;
+        bool mirror_;
         std::string remote_org_;
         std::string remote_key_;
         bool no_push_upstream_;
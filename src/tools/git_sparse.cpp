@@ -0,0 +1,104 @@
+// not using pch.h, this is also built for the tests on other platforms, see
+// src/CMakeLists.txt
+#include "git_sparse.h"
+#include "../utility/string.h"
+
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include <set>
+
+namespace mob::details {
+
+    namespace {
+
+        // last value of core.sparseCheckout in the given config file, if any;
+        // keys and section names are case insensitive
+        //
+        std::optional<bool> find_sparse_checkout(std::string_view config)
+        {
+            std::optional<bool> v;
+            bool core = false;
+
+            for_each_line(config, [&](std::string_view line) {
+                auto s = trim_copy(line);
+
+                std::transform(s.begin(), s.end(), s.begin(), [](char c) {
+                    return static_cast<char>(
+                        std::tolower(static_cast<unsigned char>(c)));
+                });
+
+                if (s.empty() || s[0] == '#' || s[0] == ';')
+                    return;
+
+                if (s[0] == '[') {
+                    core = s.starts_with("[core]");
+                    return;
+                }
+
+                if (!core)
+                    return;
+
+                const auto eq = s.find('=');
+
+                if (trim_copy(s.substr(0, eq)) != "sparsecheckout")
+                    return;
+
+                // a key without a value is true
+                if (eq == std::string::npos) {
+                    v = true;
+                    return;
+                }
+
+                const auto value = trim_copy(s.substr(eq + 1));
+                v = (value == "true" || value == "yes" || value == "on" ||
+                     value == "1");
+            });
+
+            return v;
+        }
+
+    }  // namespace
+
+    bool sparse_checkout_matches(std::string_view config,
+                                 std::string_view worktree_config,
+                                 std::string_view patterns,
+                                 const std::vector<std::string>& dirs)
+    {
+        // `git sparse-checkout disable` leaves the patterns but turns this off
+        auto enabled = find_sparse_checkout(worktree_config);
+        if (!enabled)
+            enabled = find_sparse_checkout(config);
+
+        if (!enabled.value_or(false))
+            return false;
+
+        // in cone mode, `a/b` is written as `/a/`, `!/a/*/` and `/a/b/`: parents
+        // are included, then their subdirectories are excluded, so only the
+        // included directories without an exclusion line were given to `set`
+        std::set<std::string> included, parents;
+
+        for_each_line(patterns, [&](std::string_view line) {
+            if (line.starts_with("!/") && line.ends_with("/*/"))
+                parents.emplace(line.substr(1, line.size() - 3));
+            else if (line.starts_with("/") && line.ends_with("/") && line != "/")
+                included.emplace(line);
+        });
+
+        std::set<std::string> current;
+        for (auto&& i : included) {
+            if (!parents.contains(i))
+                current.insert(i);
+        }
+
+        std::set<std::string> wanted;
+        for (auto d : dirs) {
+            std::replace(d.begin(), d.end(), '\\', '/');
+            trim(d, "/");
+            wanted.insert("/" + d + "/");
+        }
+
+        return (current == wanted);
+    }
+
+}  // namespace mob::details
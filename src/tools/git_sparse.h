@@ -0,0 +1,24 @@
+#pragma once
+
+// this is also built without pch.h for the tests, see src/CMakeLists.txt
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mob::details {
+
+    // whether a repo is a cone mode sparse-checkout of exactly the given
+    // directories, from the content of its `config`, `config.worktree` and
+    // `info/sparse-checkout` files, empty if they don't exist
+    //
+    // `git sparse-checkout set` and `git clone --sparse` turn on
+    // extensions.worktreeConfig and write core.sparseCheckout to
+    // config.worktree, which overrides config; older versions of git write it
+    // to config
+    //
+    bool sparse_checkout_matches(std::string_view config,
+                                 std::string_view worktree_config,
+                                 std::string_view patterns,
+                                 const std::vector<std::string>& dirs);
+
+}  // namespace mob::details
@@ -1,11 +1,54 @@
 #include "pch.h"
 #include "../core/conf.h"
+#include "../core/diagnostics.h"
 #include "../core/env.h"
 #include "../core/process.h"
 #include "tools.h"
 
 namespace mob {
 
+    namespace {
+
+        // total durations from all the performance summaries, by project file or
+        // target name
+        //
+        struct timings {
+            std::mutex mutex;
+            std::map<std::string, std::chrono::milliseconds> projects;
+            std::map<std::string, std::chrono::milliseconds> targets;
+        };
+
+        timings& all_timings()
+        {
+            static timings t;
+            return t;
+        }
+
+        // returns the `count` longest durations in the map, as a table
+        //
+        std::string slowest(const std::map<std::string, std::chrono::milliseconds>& m,
+                            std::size_t count)
+        {
+            std::vector<std::pair<std::string, std::chrono::milliseconds>> v(
+                m.begin(), m.end());
+
+            std::sort(v.begin(), v.end(), [](auto&& a, auto&& b) {
+                return (a.second > b.second);
+            });
+
+            if (v.size() > count)
+                v.resize(count);
+
+            std::vector<std::pair<std::string, std::string>> rows;
+
+            for (auto&& [name, ms] : v)
+                rows.push_back({std::format("{:.1f}s", ms.count() / 1000.0), name});
+
+            return table(rows, 4, 2);
+        }
+
+    }  // namespace
+
     msbuild::msbuild(ops o)
         : basic_process_runner("msbuild"), op_(o), config_(config::release),
           arch_(arch::def), flags_(noflags)
@@ -79,6 +122,97 @@ namespace mob {
         return *this;
     }
 
+    void msbuild::add_binlog_args(process& p, const fs::path& base)
+    {
+        if (!conf().global().msbuild_binlog())
+            return;
+
+        auto perf = base;
+        perf += ".perf.log";
+
+        auto binlog = base;
+        binlog += ".binlog";
+
+        // the file logger only writes the summary, the binary log has the rest
+        p.arg("-bl:", binlog, process::nospace)
+            .arg("-fileLogger")
+            .arg("-fileLoggerParameters:LogFile=" + path_to_utf8(perf) +
+                     ";Verbosity=quiet;PerformanceSummary",
+                 process::quote);
+    }
+
+    void msbuild::read_timings(const context& cx, const fs::path& base)
+    {
+        if (!conf().global().msbuild_binlog())
+            return;
+
+        auto perf = base;
+        perf += ".perf.log";
+
+        // `   1234 ms  C:\path\project.vcxproj   2 calls`
+        static const std::regex re(R"(^\s*(\d+) ms\s+(.+?)\s+\d+ calls\s*$)");
+
+        enum class sections { none, projects, targets };
+        auto section = sections::none;
+
+        auto& t = all_timings();
+        const auto s = op::read_text_file(cx, encodings::utf8, perf, op::optional);
+
+        for_each_line(s, [&](std::string_view sv) {
+            const std::string line(sv);
+            std::smatch m;
+
+            if (line.starts_with("Project Performance Summary:"))
+                section = sections::projects;
+            else if (line.starts_with("Target Performance Summary:"))
+                section = sections::targets;
+            else if (line.ends_with("Performance Summary:"))
+                section = sections::none;
+
+            if (section == sections::none || !std::regex_match(line, m, re))
+                return;
+
+            const std::chrono::milliseconds ms(std::stoll(m[1].str()));
+            const auto name = m[2].str();
+
+            if (section == sections::projects) {
+                // the project summary also has a line per target of every project
+                if (!name.ends_with("proj") && !name.ends_with(".sln"))
+                    return;
+
+                cx.trace(context::generic, "project {}: {}ms", name, ms.count());
+
+                std::scoped_lock lock(t.mutex);
+                t.projects[name] += ms;
+            }
+            else {
+                cx.trace(context::generic, "target {}: {}ms", name, ms.count());
+
+                std::scoped_lock lock(t.mutex);
+                t.targets[name] += ms;
+            }
+        });
+    }
+
+    void msbuild::log_timings(const context& cx)
+    {
+        auto& t = all_timings();
+        std::scoped_lock lock(t.mutex);
+
+        if (t.projects.empty() && t.targets.empty())
+            return;
+
+        cx.info(context::generic, "slowest msbuild projects:");
+        for_each_line(slowest(t.projects, 10), [&](auto&& line) {
+            cx.info(context::generic, "{}", line);
+        });
+
+        cx.info(context::generic, "slowest msbuild targets:");
+        for_each_line(slowest(t.targets, 10), [&](auto&& line) {
+            cx.info(context::generic, "{}", line);
+        });
+    }
+
     int msbuild::result() const
     {
         return exit_code();
@@ -138,16 +272,9 @@ namespace mob {
             p.stderr_level(context::level::trace).flags(process::allow_failure);
         }
         else {
-            p.stdout_filter([&](auto& f) {
-                // ": error C2065"
-                // ": error MSB1009"
-                static std::regex re(": error [A-Z]");
-
-                // ghetto attempt at showing errors on the console, since stdout
-                // has all the compiler output
-                if (std::regex_search(f.line.begin(), f.line.end(), re))
-                    f.lv = context::level::error;
-            });
+            // stdout has all the compiler output, this collects the warnings and
+            // errors, and shows errors on the console
+            p.stdout_filter(diagnostics::filter(cx()));
         }
 
         // msbuild will use the console's encoding, so by invoking `chcp 65001`
@@ -159,9 +286,15 @@ namespace mob {
             .arg("-nologo");
 
         if (!is_set(flags_, single_job)) {
-            // multi-process
-            p.arg("-maxCpuCount")
-                .arg("-property:UseMultiToolTask=true")
+            // multi-process, limited by global/jobs if set
+            const int jobs = conf().global().jobs();
+
+            if (jobs > 0)
+                p.arg("-maxCpuCount:" + std::to_string(jobs));
+            else
+                p.arg("-maxCpuCount");
+
+            p.arg("-property:UseMultiToolTask=true")
                 .arg("-property:EnforceProcessCountAcrossBuilds=true");
         }
 
@@ -186,7 +319,19 @@ namespace mob {
 
         p.arg(sln_).cwd(sln_.parent_path()).env(env_ ? *env_ : env::vs(arch_));
 
+        // something like `organizer-modorganizer_Clean`, next to the solution
+        std::string name = path_to_utf8(sln_.stem());
+        if (!targets.empty())
+            name += "-" + mob::join(targets, "-");
+
+        std::replace(name.begin(), name.end(), ':', '_');
+
+        const auto binlog_base = sln_.parent_path() / utf8_to_utf16(name);
+        add_binlog_args(p, binlog_base);
+
         execute_and_join(p);
+
+        read_timings(cx(), binlog_base);
     }
 
     void msbuild::do_clean()
@@ -20,6 +20,26 @@ namespace mob {
         //
         static std::string configuration_name(config c);
 
+        // when global/msbuild_binlog is set, adds `-bl` for a binary log at
+        // `base.binlog` and a file logger for a performance summary at
+        // `base.perf.log`; does nothing otherwise
+        //
+        // also used by cmake when building with the visual studio generator
+        //
+        static void add_binlog_args(process& p, const fs::path& base);
+
+        // reads the performance summary written because of add_binlog_args(),
+        // logs the duration of every project and target as traces and adds them
+        // to the totals for log_timings(); does nothing if global/msbuild_binlog
+        // is not set
+        //
+        static void read_timings(const context& cx, const fs::path& base);
+
+        // logs the slowest projects and targets of all the invocations, does
+        // nothing if there are none
+        //
+        static void log_timings(const context& cx);
+
         enum class flags_t { noflags = 0x00, single_job = 0x01, allow_failure = 0x02 };
         using enum flags_t;
 
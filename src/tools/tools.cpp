@@ -10,7 +10,7 @@ namespace mob {
     }
 
     tool::tool(tool&& t)
-        : name_(std::move(t.name_)), interrupted_(t.interrupted_.load())
+        : cx_(t.cx_), name_(std::move(t.name_)), interrupted_(t.interrupted_.load())
     {
     }
 
@@ -315,6 +315,23 @@ namespace mob {
         return conf().tool().get("lrelease");
     }
 
+    std::string lrelease::version()
+    {
+        // lrelease doesn't change while mob is running, only run it once
+        static const std::string v = [] {
+            auto p = process()
+                         .binary(binary())
+                         .arg("-version")
+                         .stdout_flags(process::keep_in_string);
+
+            p.run_and_join();
+
+            return trim_copy(p.stdout_string());
+        }();
+
+        return v;
+    }
+
     lrelease& lrelease::project(const std::string& name)
     {
         project_ = name;
@@ -372,10 +389,18 @@ namespace mob {
         for (auto&& s : sources_)
             p.arg(s);
 
+        const auto target = out_ / qm;
+        const auto temp   = out_ / (qm.native() + L".tmp");
+
         // output .qm file
-        p.arg("-qm", (out_ / qm));
+        p.arg("-qm", temp);
 
         execute_and_join(p);
+
+        if (fs::exists(target))
+            op::replace_file(cx(), target, temp);
+        else
+            op::rename(cx(), temp, target);
     }
 
     iscc::iscc(fs::path iss) : basic_process_runner("iscc"), iss_(std::move(iss)) {}
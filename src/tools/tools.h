@@ -5,9 +5,12 @@
 #include "../core/op.h"
 #include "../net.h"
 
+struct archive;
+
 namespace mob {
 
     class process;
+    class byte_pipe;
 
     // all the various tools used by mob itself or the tasks, most of them inherit
     // from basic_process_runner, which is a small wrapper around a `process`,
@@ -134,6 +137,12 @@ namespace mob {
     // and run() returns immediately; result() can be used to figure out the path
     // of the file
     //
+    // if extract_to() is called and the archive can be read sequentially, it's
+    // extracted while it's being downloaded; the archive is still written to the
+    // output file, so it can be extracted normally from result() afterwards if
+    // extracted() returns false, such as when streaming wasn't possible or the
+    // file was already in the cache
+    //
     class downloader : public tool {
     public:
         // what run() should do
@@ -162,11 +171,22 @@ namespace mob {
         //
         downloader& file(const fs::path& p);
 
+        // directory where the archive should be extracted while downloading,
+        // see the comment at the top of the class
+        //
+        downloader& extract_to(const fs::path& dir);
+
         // path to the output file; this is file() if it was called, or the
         // generated name if it wasn't, which can vary if multiple urls were given
         //
         fs::path result() const;
 
+        // whether the archive was completely extracted to extract_to() while it
+        // was being downloaded, in which case it doesn't need to be extracted
+        // again
+        //
+        bool extracted() const;
+
     protected:
         // cleans or downloads
         //
@@ -190,6 +210,15 @@ namespace mob {
         // every url added with url()
         std::vector<mob::url> urls_;
 
+        // given in extract_to(), may be empty
+        fs::path extract_to_;
+
+        // extractor running while downloading, used by do_interrupt()
+        tool* extractor_;
+
+        // see extracted()
+        bool extracted_;
+
         // deletes an already downloaded file, no-op if not found
         //
         void do_clean();
@@ -210,6 +239,17 @@ namespace mob {
         // tries to download the given url, returns whether it succeeded
         //
         bool try_download(const mob::url& u);
+
+        // whether the output file can be extracted while it's being downloaded,
+        // which is only possible for formats that libarchive can read without
+        // seeking
+        //
+        bool can_stream() const;
+
+        // downloads the given url and extracts it to extract_to_ at the same
+        // time, returns whether the download succeeded
+        //
+        bool try_download_and_extract(const mob::url& u);
     };
 
     // base class for tools that run processes
@@ -312,14 +352,68 @@ namespace mob {
         //
         extractor& output(const fs::path& dir);
 
+        // reads the archive from the given pipe instead of file(), which is only
+        // used for logging; if libarchive can't read the archive sequentially,
+        // the output directory is deleted and file() should be extracted
+        // normally once the download is finished
+        //
+        // the pipe must live until run() returns
+        //
+        extractor& stream(byte_pipe* p);
+
+        // whether the last run() extracted the whole archive; false if the
+        // output directory already existed and was left alone, or if
+        // extraction failed or was interrupted
+        //
+        bool extracted() const;
+
     protected:
         // extracts the file
         //
         void do_run() override;
 
+        // closes the pipe, if any, and interrupts 7z
+        //
+        void do_interrupt() override;
+
     private:
         fs::path file_;
         fs::path where_;
+        byte_pipe* pipe_;
+        bool extracted_;
+
+        // extracts the archive in-process with libarchive in a single pass, files
+        // are written in parallel; top level directories are handled after
+        // extraction by check_for_top_level_directory()
+        //
+        // when `resuming` is true, files that already exist with the same size
+        // and time are skipped
+        //
+        // returns false if libarchive can't handle the archive or if it contains
+        // links, in which case the output directory is cleaned up and 7z should
+        // be used instead
+        //
+        bool extract_builtin(const fs::path& ifile, bool resuming);
+
+        // extracts the archive from pipe_ with libarchive, top level directories
+        // are handled after extraction by check_for_top_level_directory(); returns
+        // false if the archive can't be read sequentially
+        //
+        bool extract_stream(const fs::path& ifile, bool resuming);
+
+        // extracts all the entries from the given archive into the output
+        // directory, used by both extract_builtin() and extract_stream(); on
+        // failure, the output directory is cleaned up and false is returned
+        //
+        // symbolic and hard links are not extracted, they make this fail so 7z
+        // handles the archive instead
+        //
+        bool extract_entries(archive* a, bool resuming, const fs::path& ifile);
+
+        // extracts the archive with 7z, used as a fallback for archives that
+        // libarchive can't handle
+        //
+        void extract_7z();
 
         // some archives have a top level directory, this moves all the files up one
         // directory and deletes the now empty top level directory
@@ -332,20 +426,45 @@ namespace mob {
     // this isn't used by any task, but it's used in a few places in op.cpp, mostly
     // for creating archives with the `release` command
     //
+    // the format and compression settings come from a conf_archive profile: 7z
+    // and zip archives are created by 7z, tar.zst archives by libarchive
+    //
     class archiver : public basic_process_runner {
     public:
         // archives all the files matching `glob` into a file `out`, ignoring
         // anything that matches a string in `ignore`
         //
+        // `threads` is the maximum number of threads the archiver can use, 0 to
+        // use the profile's thread count
+        //
         static void create_from_glob(const context& cx, const fs::path& out,
                                      const fs::path& glob,
-                                     const std::vector<std::string>& ignore);
+                                     const std::vector<std::string>& ignore,
+                                     const conf_archive& profile,
+                                     std::size_t threads = 0);
 
-        // archives all the given files rooted in `files_root`, into a file `out`
+        // archives all the given files rooted in `files_root`, into a file `out`,
+        // see create_from_glob() for `threads`
         //
         static void create_from_files(const context& cx, const fs::path& out,
                                       const std::vector<fs::path>& files,
-                                      const fs::path& files_root);
+                                      const fs::path& files_root,
+                                      const conf_archive& profile,
+                                      std::size_t threads = 0);
+
+    private:
+        // adds the format and compression switches from the profile to a 7z
+        // command line
+        //
+        static void add_7z_args(process& p, const conf_archive& profile,
+                                std::size_t threads);
+
+        // creates a .tar.zst from the given files, which are relative to `root`
+        //
+        static void create_tar_zst(const context& cx, const fs::path& out,
+                                   const fs::path& root,
+                                   const std::vector<fs::path>& files,
+                                   const conf_archive& profile, std::size_t threads);
     };
 
     // tool that runs devenv.exe, only invoked to upgrade projects for now
@@ -513,6 +632,12 @@ namespace mob {
         //
         static fs::path binary();
 
+        // output of `lrelease -version`, used to rebuild all the translations
+        // when lrelease changes; empty on dry runs; lrelease is only run the
+        // first time this is called
+        //
+        static std::string version();
+
         lrelease();
 
         // name of the project, used to generate the output filename, which is
@@ -552,7 +677,8 @@ namespace mob {
         fs::path qm_file() const;
 
     protected:
-        // runs lrelease on the given sources
+        // runs lrelease on the given sources; the .qm file is written to a
+        // temporary file first and renamed, so it's never left half-written
         //
         void do_run() override;
 
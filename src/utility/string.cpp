@@ -1,6 +1,19 @@
-#include "pch.h"
+// not using pch.h, this is also built for the tests and benchmarks on other
+// platforms, see src/CMakeLists.txt
 #include "string.h"
-#include "../utility.h"
+
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include <optional>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace mob {
 
@@ -173,6 +186,8 @@ namespace mob {
         return s;
     }
 
+#ifdef _WIN32
+
     std::optional<std::wstring> to_widechar(UINT from, std::string_view s)
     {
         std::wstring ws;
@@ -254,17 +269,177 @@ namespace mob {
         return std::move(*ws);
     }
 
+#else
+
+    // there are no code pages outside of windows, this is only used by the
+    // tests; bytes that don't start a complete sequence are converted to U+FFFD
+    //
+    std::wstring utf8_to_utf16(std::string_view s)
+    {
+        std::wstring ws;
+        ws.reserve(s.size());
+
+        std::size_t i = 0;
+
+        while (i < s.size()) {
+            const auto b = static_cast<unsigned char>(s[i]);
+
+            // length of the sequence and the bits of the first byte
+            std::size_t n = 0;
+            char32_t c    = 0;
+
+            if (b < 0x80) {
+                n = 1;
+                c = b;
+            }
+            else if ((b & 0xe0) == 0xc0) {
+                n = 2;
+                c = b & 0x1f;
+            }
+            else if ((b & 0xf0) == 0xe0) {
+                n = 3;
+                c = b & 0x0f;
+            }
+            else if ((b & 0xf8) == 0xf0) {
+                n = 4;
+                c = b & 0x07;
+            }
+
+            bool ok = (n > 0 && i + n <= s.size());
+
+            for (std::size_t j = 1; ok && j < n; ++j) {
+                const auto cb = static_cast<unsigned char>(s[i + j]);
+
+                ok = ((cb & 0xc0) == 0x80);
+                c  = (c << 6) | (cb & 0x3f);
+            }
+
+            if (!ok) {
+                ws += static_cast<wchar_t>(0xfffd);
+                ++i;
+                continue;
+            }
+
+            ws += static_cast<wchar_t>(c);
+            i += n;
+        }
+
+        return ws;
+    }
+
+#endif
+
     std::string utf16_to_utf8(std::wstring_view ws)
     {
-        auto s = to_multibyte(CP_UTF8, ws);
-        if (!s) {
-            std::wcerr << L"can't convert from utf16 to utf8\n";
-            return "???";
+        std::string s;
+        s.resize(utf16_to_utf8(ws, s));
+        return s;
+    }
+
+    template <class CharT>
+    std::size_t utf16_to_utf8_impl(std::basic_string_view<CharT> ws, std::string& out)
+    {
+        // a utf16 code unit is at most 3 bytes in utf8, a surrogate pair is two
+        // units for 4 bytes; wchar_t is utf32 outside of windows
+        constexpr std::size_t max_bytes = (sizeof(CharT) == 2 ? 3 : 4);
+
+        // only grown, resize() zeroes the new bytes and this is called for
+        // every line
+        if (out.size() < ws.size() * max_bytes)
+            out.resize(ws.size() * max_bytes);
+
+        const CharT* p         = ws.data();
+        const CharT* const end = ws.data() + ws.size();
+        char* o                = out.data();
+
+        const auto put = [&](char32_t c) {
+            *o++ = static_cast<char>(c);
+        };
+
+        while (p != end) {
+#if defined(_M_X64) || defined(__SSE2__)
+            if constexpr (sizeof(CharT) == 2) {
+                // ascii fast path, 8 characters at a time; there's always room
+                // for 8 bytes in `out` since at least 24 were reserved for them
+                const __m128i high = _mm_set1_epi16(static_cast<short>(0xff80));
+
+                while (end - p >= 8) {
+                    const __m128i v =
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+
+                    const __m128i is_ascii =
+                        _mm_cmpeq_epi16(_mm_and_si128(v, high), _mm_setzero_si128());
+
+                    if (_mm_movemask_epi8(is_ascii) != 0xffff)
+                        break;
+
+                    // every character is < 0x80, packing them to bytes is
+                    // lossless
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(o),
+                                     _mm_packus_epi16(v, v));
+
+                    p += 8;
+                    o += 8;
+                }
+
+                if (p == end)
+                    break;
+            }
+#endif
+
+            char32_t c = static_cast<char32_t>(*p++);
+
+            if (c >= 0xd800 && c <= 0xdfff) {
+                // a high surrogate followed by a low one is a pair, anything
+                // else is invalid
+                const bool pair = (c <= 0xdbff && p != end && *p >= 0xdc00 &&
+                                   *p <= 0xdfff);
+
+                if (pair)
+                    c = 0x10000 + ((c - 0xd800) << 10) + (char32_t(*p++) - 0xdc00);
+                else
+                    c = 0xfffd;
+            }
+            else if (c > 0x10ffff) {
+                c = 0xfffd;
+            }
+
+            if (c < 0x80) {
+                put(c);
+            }
+            else if (c < 0x800) {
+                put(0xc0 | (c >> 6));
+                put(0x80 | (c & 0x3f));
+            }
+            else if (c < 0x10000) {
+                put(0xe0 | (c >> 12));
+                put(0x80 | ((c >> 6) & 0x3f));
+                put(0x80 | (c & 0x3f));
+            }
+            else {
+                put(0xf0 | (c >> 18));
+                put(0x80 | ((c >> 12) & 0x3f));
+                put(0x80 | ((c >> 6) & 0x3f));
+                put(0x80 | (c & 0x3f));
+            }
         }
 
-        return std::move(*s);
+        MOB_ASSERT(o >= out.data() && o <= out.data() + out.size());
+        return static_cast<std::size_t>(o - out.data());
     }
 
+    std::size_t utf16_to_utf8(std::wstring_view ws, std::string& out)
+    {
+        return utf16_to_utf8_impl(ws, out);
+    }
+
+    std::size_t utf16_to_utf8(std::u16string_view s, std::string& out)
+    {
+        return utf16_to_utf8_impl(s, out);
+    }
+
+#ifdef _WIN32
+
     std::wstring cp_to_utf16(UINT from, std::string_view s)
     {
         auto ws = to_widechar(from, s);
@@ -288,6 +463,8 @@ namespace mob {
         return std::move(*s);
     }
 
+#endif
+
     std::string bytes_to_utf8(encodings e, std::string_view s)
     {
         switch (e) {
@@ -297,6 +474,8 @@ namespace mob {
             return utf16_to_utf8({ws, chars});
         }
 
+        // code pages only exist on windows, they're treated as utf8 elsewhere
+#ifdef _WIN32
         case encodings::acp: {
             const std::wstring utf16 = cp_to_utf16(CP_ACP, s);
             return utf16_to_utf8(utf16);
@@ -306,6 +485,7 @@ namespace mob {
             const std::wstring utf16 = cp_to_utf16(CP_OEMCP, s);
             return utf16_to_utf8(utf16);
         }
+#endif
 
         case encodings::utf8:
         case encodings::dont_know:
@@ -323,6 +503,7 @@ namespace mob {
                                ws.size() * sizeof(wchar_t));
         }
 
+#ifdef _WIN32
         case encodings::acp: {
             return utf16_to_cp(CP_ACP, ws);
         }
@@ -330,6 +511,7 @@ namespace mob {
         case encodings::oem: {
             return utf16_to_cp(CP_OEMCP, ws);
         }
+#endif
 
         case encodings::utf8:
         case encodings::dont_know:
@@ -359,7 +541,78 @@ namespace mob {
 
     std::string path_to_utf8(fs::path p)
     {
+#ifdef _WIN32
         return utf16_to_utf8(p.native());
+#else
+        return p.string();
+#endif
+    }
+
+    namespace {
+
+        template <class CharT>
+        const CharT* find_newline_impl(const CharT* p, const CharT* end)
+        {
+#if defined(_M_X64) || defined(__SSE2__)
+            // characters in a 16 bytes register
+            constexpr std::size_t width = 16 / sizeof(CharT);
+
+            // compares 16 bytes against \n and \r at once, the mask has one bit
+            // per byte, so two bits per character for wchar_t, or four outside
+            // of windows where wchar_t is utf32
+            const auto compare = [](const CharT* chars) {
+                const __m128i v =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(chars));
+
+                __m128i lf, cr;
+
+                if constexpr (sizeof(CharT) == 1) {
+                    lf = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+                    cr = _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'));
+                }
+                else if constexpr (sizeof(CharT) == 2) {
+                    lf = _mm_cmpeq_epi16(v, _mm_set1_epi16(L'\n'));
+                    cr = _mm_cmpeq_epi16(v, _mm_set1_epi16(L'\r'));
+                }
+                else {
+                    static_assert(sizeof(CharT) == 4);
+                    lf = _mm_cmpeq_epi32(v, _mm_set1_epi32(L'\n'));
+                    cr = _mm_cmpeq_epi32(v, _mm_set1_epi32(L'\r'));
+                }
+
+                return static_cast<unsigned int>(
+                    _mm_movemask_epi8(_mm_or_si128(lf, cr)));
+            };
+
+            while (static_cast<std::size_t>(end - p) >= width) {
+                const unsigned int mask = compare(p);
+
+                if (mask != 0)
+                    return p + std::countr_zero(mask) / sizeof(CharT);
+
+                p += width;
+            }
+#endif
+
+            // leftovers, or everything when sse2 is not available
+            for (; p != end; ++p) {
+                if (*p == CharT('\n') || *p == CharT('\r'))
+                    return p;
+            }
+
+            return end;
+        }
+
+    }  // namespace
+
+    const char* find_newline(const char* begin, const char* end)
+    {
+        return find_newline_impl(begin, end);
+    }
+
+    const wchar_t* find_newline(const wchar_t* begin, const wchar_t* end)
+    {
+        return find_newline_impl(begin, end);
     }
 
     encoded_buffer::encoded_buffer(encodings e, std::string bytes)
@@ -1,9 +1,18 @@
 #pragma once
 
+// this is also built without pch.h for the tests and benchmarks, see
+// src/CMakeLists.txt
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include "assert.h"
 
 namespace mob {
 
+    namespace fs = std::filesystem;
+
     enum class encodings {
         dont_know = 0,
         utf8,
@@ -73,7 +82,8 @@ namespace mob {
     std::string table(const std::vector<std::pair<std::string, std::string>>& v,
                       std::size_t indent, std::size_t spacing);
 
-    // converts a utf8 string to utf16
+    // converts a utf8 string to utf16; wchar_t is utf32 outside of windows,
+    // where this is only used by the tests
     //
     std::wstring utf8_to_utf16(std::string_view s);
 
@@ -81,6 +91,23 @@ namespace mob {
     //
     std::string utf16_to_utf8(std::wstring_view ws);
 
+    // converts a utf16 string to utf8 at the start of `out` and returns the
+    // number of bytes written; the bytes after that are unspecified
+    //
+    // `out` is only grown when it's too small, it's not shrunk or filled again
+    // for every call, so it can be reused for every line of output of a process
+    // without allocating
+    //
+    // ascii is copied 8 characters at a time with sse2 when available; unpaired
+    // surrogates are converted to U+FFFD, like WideCharToMultiByte() does
+    //
+    std::size_t utf16_to_utf8(std::wstring_view ws, std::string& out);
+
+    // same as above for char16_t, which is utf16 on every platform, unlike
+    // wchar_t
+    //
+    std::size_t utf16_to_utf8(std::u16string_view s, std::string& out);
+
     // converts bytes of the given encoding to utf8
     //
     std::string bytes_to_utf8(encodings e, std::string_view bytes);
@@ -98,51 +125,50 @@ namespace mob {
     //
     std::string path_to_utf8(fs::path p);
 
+    // returns a pointer to the first \n or \r in [begin, end), or `end` if there
+    // are none
+    //
+    // this is used to split the output of processes into lines, so it checks
+    // 16 bytes at a time with sse2 when available
+    //
+    const char* find_newline(const char* begin, const char* end);
+    const wchar_t* find_newline(const wchar_t* begin, const wchar_t* end);
+
+    // returns a pointer to the first character in [begin, end) that is not \n
+    // or \r, or `end` if there are none
+    //
+    template <class CharT>
+    const CharT* skip_newlines(const CharT* begin, const CharT* end)
+    {
+        while (begin != end && (*begin == CharT('\n') || *begin == CharT('\r')))
+            ++begin;
+
+        return begin;
+    }
+
     // calls f() for each line in the given string, skipping empty lines
     //
     template <class F>
     void for_each_line(std::string_view s, F&& f)
     {
-        if (s.empty())
-            return;
-
         const char* const begin = s.data();
         const char* const end   = s.data() + s.size();
 
-        const char* start = begin;
-        const char* p     = begin;
+        const char* p = begin;
 
-        for (;;) {
+        while (p != end) {
             MOB_ASSERT(p && p >= begin && p <= end);
-            MOB_ASSERT(start && start >= begin && start <= end);
-
-            if (p == end || *p == '\n' || *p == '\r') {
-                // end of line or string
-
-                if (p != start) {
-                    // line was not empty
-                    MOB_ASSERT(p >= start);
 
-                    const auto n = static_cast<std::size_t>(p - start);
-                    MOB_ASSERT(n <= s.size());
-
-                    f(std::string_view(start, n));
-                }
+            // end of line or string
+            const char* const nl = find_newline(p, end);
+            MOB_ASSERT(nl >= p && nl <= end);
 
-                // skip to start of next line
-                while (p != end && (*p == '\n' || *p == '\r'))
-                    ++p;
+            // line was not empty
+            if (nl != p)
+                f(std::string_view(p, static_cast<std::size_t>(nl - p)));
 
-                MOB_ASSERT(p && p >= begin && p <= end);
-
-                if (p == end)
-                    break;
-
-                start = p;
-            }
-            else {
-                ++p;
-            }
+            // skip to start of next line
+            p = skip_newlines(nl, end);
         }
     }
 
@@ -150,8 +176,9 @@ namespace mob {
     // function with every line
     //
     // the output of a process is stored in an encoded_buffer and next_utf8_lines()
-    // is called to process every line in it, avoiding copies or memory allocation,
-    // except for conversions to utf8 when necessary
+    // is called to process every line in it, avoiding copies or memory allocation;
+    // utf16 is converted into a buffer that's reused for every line, other code
+    // pages are converted to a new string
     //
     // if the encoding is dont_know, the buffer is basically interpreted as ascii
     // for checking newlines and the bytes are given as-is to the callback
@@ -170,9 +197,10 @@ namespace mob {
         //
         std::string utf8_string() const;
 
-        // calls `f()` with a utf8 string for every non-empty line in the buffer;
-        // remembers the final offset when next_utf8_lines() was last called so
-        // lines are only processed once
+        // calls `f()` with a utf8 string_view for every non-empty line in the
+        // buffer, which is only valid until `f()` returns; remembers the final
+        // offset when next_utf8_lines() was last called so lines are only
+        // processed once
         //
         // if `finished` is false, it's assumed that more bytes will arrive
         // eventually, so the bytes after the last newline in the buffer are not
@@ -198,7 +226,8 @@ namespace mob {
                     if (utf16.empty())
                         return;
 
-                    f(utf16_to_utf8(utf16));
+                    const auto n = utf16_to_utf8(utf16, utf8_);
+                    f(std::string_view(utf8_.data(), n));
                     break;
                 }
 
@@ -209,7 +238,7 @@ namespace mob {
                     if (cp.empty())
                         return;
 
-                    f(bytes_to_utf8(e_, cp));
+                    f(std::string_view(bytes_to_utf8(e_, cp)));
                     break;
                 }
 
@@ -221,7 +250,7 @@ namespace mob {
                     if (utf8.empty())
                         return;
 
-                    f(std::string(utf8));
+                    f(utf8);
                     break;
                 }
                 }
@@ -239,6 +268,10 @@ namespace mob {
         // called
         std::size_t last_;
 
+        // lines converted from utf16, reused so its size grows to the longest
+        // line instead of allocating for every line, see utf16_to_utf8()
+        std::string utf8_;
+
         // looks for the next newline character after last_ and returns a
         // string_view of the data between the two; empty lines are ignored,
         // handles both lf and crlf the same
@@ -252,21 +285,14 @@ namespace mob {
         {
             // number of available bytes in the buffer
             //
-            // for utf16, it's possible (but unlikely) that the buffer has an odd
-            // number of bytes if not all the output was flushed, so don't check the
-            // last stray byte
+            // for utf16, it's possible (but unlikely) that the buffer ends in the
+            // middle of a character if not all the output was flushed, so don't
+            // check the last stray byte
             //
             // this doesn't handle stray bytes for other encodings, but they use
             // single bytes for cr and lf, so it's fine
             //
-            const std::size_t size = [&] {
-                if constexpr (sizeof(CharT) == 2) {
-                    if ((bytes.size() & 1) == 1)
-                        return bytes.size() - 1;
-                }
-
-                return bytes.size();
-            }();
+            const std::size_t size = bytes.size() - (bytes.size() % sizeof(CharT));
 
             // position just past where the last newline was found
             const CharT* start =
@@ -284,24 +310,24 @@ namespace mob {
 
             // looking for a non-empty line
             while (p != end) {
-                if (*p == CharT('\n') || *p == CharT('\r')) {
-                    line = {start, static_cast<std::size_t>(p - start)};
+                p = find_newline(p, end);
 
-                    // skip newline characters from this point
-                    while (p != end && (*p == CharT('\n') || *p == CharT('\r')))
-                        ++p;
+                // no newline, the rest of the buffer is an incomplete line
+                if (p == end)
+                    break;
 
-                    // line is not empty, take it
-                    if (!line.empty())
-                        break;
+                line = {start, static_cast<std::size_t>(p - start)};
 
-                    // line can be empty for something like \n\n, continue looking
-                    // for a non-empty line if that's the case
-                    start = p;
-                }
-                else {
-                    ++p;
-                }
+                // skip newline characters from this point
+                p = skip_newlines(p, end);
+
+                // line is not empty, take it
+                if (!line.empty())
+                    break;
+
+                // line can be empty for something like \n\n, continue looking
+                // for a non-empty line if that's the case
+                start = p;
             }
 
             // if the line is empty but `finished` is true, make sure the last
@@ -310,13 +336,16 @@ namespace mob {
             if (line.empty()) {
                 if (finished) {
                     // the line is from past the last newline to the end of the
-                    // buffer; this may be empty if the buffer actually ends with
-                    // a newline, which is fine
-                    line = {reinterpret_cast<const CharT*>(bytes.data() + byte_offset),
-                            size - byte_offset};
-
-                    // tell the caller that whole thing has been processed
-                    byte_offset = bytes.size();
+                    // buffer, `start` has skipped any newlines that were at the
+                    // offset, such as the \n of a \r\n split between two reads;
+                    // this may be empty if the buffer actually ends with a
+                    // newline, which is fine
+                    line = {start, static_cast<std::size_t>(end - start)};
+
+                    // tell the caller that whole thing has been processed; this
+                    // is `size` and not bytes.size() so a stray byte isn't
+                    // skipped past the end of the characters
+                    byte_offset = size;
                 }
             }
             else {
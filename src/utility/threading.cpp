@@ -245,4 +245,101 @@ namespace mob {
         return false;
     }
 
+    byte_pipe::byte_pipe(std::size_t max_buffered)
+        : max_(max_buffered),
+          offset_(0),
+          size_(0),
+          write_closed_(false),
+          read_closed_(false),
+          ok_(false)
+    {
+    }
+
+    bool byte_pipe::write(const char* data, std::size_t size)
+    {
+        while (size > 0) {
+            std::unique_lock lock(m_);
+
+            cv_.wait(lock, [&] {
+                return (read_closed_ || size_ < max_);
+            });
+
+            if (read_closed_)
+                return false;
+
+            const auto n = std::min(size, max_ - size_);
+            blocks_.emplace_back(data, data + n);
+            size_ += n;
+
+            data += n;
+            size -= n;
+
+            cv_.notify_all();
+        }
+
+        return true;
+    }
+
+    void byte_pipe::close_write(bool ok)
+    {
+        {
+            std::scoped_lock lock(m_);
+            write_closed_ = true;
+            ok_           = ok;
+        }
+
+        cv_.notify_all();
+    }
+
+    void byte_pipe::close_read()
+    {
+        {
+            std::scoped_lock lock(m_);
+            read_closed_ = true;
+            blocks_.clear();
+            offset_ = 0;
+            size_   = 0;
+        }
+
+        cv_.notify_all();
+    }
+
+    std::size_t byte_pipe::read(char* data, std::size_t size)
+    {
+        std::unique_lock lock(m_);
+
+        cv_.wait(lock, [&] {
+            return (write_closed_ || read_closed_ || size_ > 0);
+        });
+
+        std::size_t n = 0;
+
+        while (n < size && !blocks_.empty()) {
+            const auto& b     = blocks_.front();
+            const auto length = std::min(size - n, b.size() - offset_);
+
+            std::memcpy(data + n, b.data() + offset_, length);
+
+            n += length;
+            offset_ += length;
+
+            if (offset_ == b.size()) {
+                blocks_.pop_front();
+                offset_ = 0;
+            }
+        }
+
+        size_ -= n;
+
+        cv_.notify_all();
+
+        return n;
+    }
+
+    bool byte_pipe::ok() const
+    {
+        std::scoped_lock lock(m_);
+        return ok_;
+    }
+
 }  // namespace mob
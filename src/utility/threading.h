@@ -57,4 +57,63 @@ namespace mob {
         bool try_add(fun thread_fun);
     };
 
+    // a bounded queue of bytes between one writing and one reading thread, used
+    // to feed a download directly into an extractor
+    //
+    // write() blocks while the buffer is full and read() blocks while it's
+    // empty; either side can close the pipe, which unblocks the other one
+    //
+    class byte_pipe {
+    public:
+        byte_pipe(std::size_t max_buffered = 8 * 1024 * 1024);
+
+        // non-copyable
+        byte_pipe(const byte_pipe&)            = delete;
+        byte_pipe& operator=(const byte_pipe&) = delete;
+
+        // appends the given bytes, blocks while the buffer is full; returns
+        // false if the reader has closed the pipe, in which case the bytes are
+        // dropped
+        //
+        bool write(const char* data, std::size_t size);
+
+        // tells the reader that there won't be any more bytes; `ok` is false if
+        // the writer failed or was interrupted
+        //
+        void close_write(bool ok);
+
+        // tells the writer that the reader doesn't want any more bytes
+        //
+        void close_read();
+
+        // copies at most `size` bytes into `data`, blocks until there's
+        // something to read; returns 0 once the writer has closed the pipe and
+        // everything has been read, or if close_read() was called
+        //
+        std::size_t read(char* data, std::size_t size);
+
+        // whether the writer closed the pipe with `ok`, only meaningful after
+        // read() has returned 0
+        //
+        bool ok() const;
+
+    private:
+        const std::size_t max_;
+        mutable std::mutex m_;
+        std::condition_variable cv_;
+
+        // one block per write(), copied out in bulk by read()
+        std::deque<std::vector<char>> blocks_;
+
+        // bytes of the first block that were already read
+        std::size_t offset_;
+
+        // total number of unread bytes in blocks_
+        std::size_t size_;
+
+        bool write_closed_;
+        bool read_closed_;
+        bool ok_;
+    };
+
 }  // namespace mob